@@ -0,0 +1,89 @@
+// visibility query cost against scene size: culling every mesh one by one vs querying the Scene's
+// BVH. density is constant so the number of visible meshes stays roughly flat as the world grows.
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include "../include/Triangle.hpp"
+#include "../include/Camera.hpp"
+#include "../include/Frustum.hpp"
+#include "../include/Scene.hpp"
+
+constexpr int FRAMES = 200;
+constexpr double CAM_FOV = PI/2.0;
+constexpr double CAM_GAP = 0.1;
+constexpr double CAM_FAR = 20.0;
+
+// meshes per 40x40x40 block of world
+constexpr double DENSITY = 1000.0 / (40.0 * 40.0 * 40.0);
+
+template <typename F>
+double seconds_per_frame(F frame) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < FRAMES; i++) {
+        frame(i);
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / FRAMES;
+}
+
+int main() {
+    std::cout << "meshes\tvisible\tlinear us\tbvh us\tmove 1% us\n";
+
+    for (int n : {1000, 4000, 16000, 64000, 256000}) {
+        std::mt19937 rng (1234);
+        const double half = std::cbrt(n / DENSITY) / 2.0;
+        std::uniform_real_distribution<double> dist (-half, half);
+
+        std::vector<Mesh<double>> meshes;
+        Scene<double> scene;
+        meshes.reserve(n);
+        for (int i = 0; i < n; i++) {
+            meshes.push_back(MakeCube<double>(Point<double>(dist(rng), dist(rng), dist(rng)), 0.5));
+            scene.add(meshes.back());
+        }
+
+        // the camera turns on the spot, so every frame sees a different part of the world
+        const auto frustum = [](int frame) {
+            const double camera = frame * (2.0 * PI / FRAMES);
+            return Frustum<double>(make_projection_matrix<double>(CAM_FOV, CAM_GAP, CAM_FAR) * make_view_matrix(Point<double>(0, 0, 0), camera));
+        };
+
+        std::vector<const Mesh<double>*> visible;
+        std::size_t linear_visible = 0;
+        const double linear = seconds_per_frame([&](int frame) {
+            const Frustum<double> f = frustum(frame);
+            visible.clear();
+            for (const Mesh<double>& m : meshes) {
+                if (f.intersects(m.bounds)) {
+                    visible.push_back(&m);
+                }
+            }
+            linear_visible += visible.size();
+        });
+
+        std::size_t bvh_visible = 0;
+        const double bvh = seconds_per_frame([&](int frame) {
+            scene.query(frustum(frame), visible);
+            bvh_visible += visible.size();
+        });
+
+        // nudge 1% of the meshes each frame through the incremental refit
+        std::uniform_int_distribution<std::size_t> pick (0, n - 1);
+        std::uniform_real_distribution<double> nudge (-0.2, 0.2);
+        const double move = seconds_per_frame([&](int) {
+            for (int i = 0; i < n / 100; i++) {
+                const std::size_t id = pick(rng);
+                const Point<double> o = scene.mesh(id).origin();
+                scene.set_origin(id, Point<double>(o.x + nudge(rng), o.y + nudge(rng), o.z + nudge(rng)));
+            }
+        });
+
+        if (linear_visible != bvh_visible) {
+            std::cout << "mismatch: linear saw " << linear_visible << ", bvh saw " << bvh_visible << '\n';
+        }
+        std::cout << n << '\t' << bvh_visible / FRAMES << '\t' << linear * 1e6 << "\t\t" << bvh * 1e6 << '\t' << move * 1e6 << '\n';
+    }
+    return 0;
+}
@@ -0,0 +1,370 @@
+// repeatable microbenchmarks of the hot paths and full frames of synthetic scenes. every run uses
+// the same seed and camera path, so the work done per iteration is identical between runs and
+// commits and only the time it takes changes. prints median/p99 per iteration and writes them as
+// csv, which a later run can be compared against:
+//
+//   suite_bench [--out results.csv] [--compare baseline.csv] [--threshold 0.1] [--quick]
+//
+// --compare exits non zero when any benchmark's median got slower than the baseline's by more
+// than the threshold (a fraction), or its checksum changed.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include "../include/Triangle.hpp"
+#include "../include/Fixed.hpp"
+#include "../include/Camera.hpp"
+#include "../include/CohenSutherlandClip.hpp"
+#include "../include/LineClip.hpp"
+#include "../include/JobSystem.hpp"
+#include "../include/Scene.hpp"
+#include "../include/Pipeline.hpp"
+#include "../include/LineBatch.hpp"
+#include "../include/Framebuffer.hpp"
+#include "../include/TileRasterizer.hpp"
+
+constexpr uint32_t SEED = 1234;
+constexpr int WARMUP = 3;
+constexpr double CAM_FOV = PI/2.0;
+constexpr double CAM_GAP = 0.1;
+constexpr double CAM_FAR = 100.0;
+constexpr Viewport VIEWPORT {1080, 720};
+
+struct BenchResult {
+    std::string name;
+    int iterations;
+    double median_ms;
+    double p99_ms;
+    uint64_t checksum; // of the work's output, must not change between runs
+};
+
+// WARMUP untimed calls, then iterations timed ones. fn(i) returns a checksum of what it did.
+BenchResult run(const std::string& name, int iterations, const std::function<uint64_t(int)>& fn) {
+    for (int i = 0; i < WARMUP; i++) {
+        fn(i);
+    }
+    std::vector<double> ms;
+    uint64_t checksum = 0;
+    for (int i = 0; i < iterations; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        checksum = checksum * 31 + fn(i);
+        ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(ms.begin(), ms.end());
+    const std::size_t p99 = static_cast<std::size_t>(std::ceil(0.99 * ms.size())) - 1;
+    const BenchResult r {name, iterations, ms[ms.size() / 2], ms[p99], checksum};
+    std::printf("%-24s %6d iterations  median %10.4f ms  p99 %10.4f ms\n", r.name.c_str(), r.iterations, r.median_ms, r.p99_ms);
+    return r;
+}
+
+// uv sphere of radius 0.5 with 2 * segments * (rings - 1) faces
+template <Numeric N>
+GeometryPtr<N> make_sphere(int rings, int segments) {
+    std::vector<Point<N>> verts;
+    std::vector<Face> faces;
+    verts.push_back(Point<N>(0, 0.5, 0));
+    for (int i = 1; i < rings; i++) {
+        const double theta = PI * i / rings;
+        for (int j = 0; j < segments; j++) {
+            const double phi = 2 * PI * j / segments;
+            verts.push_back(Point<N>(0.5 * sin(theta) * cos(phi), 0.5 * cos(theta), 0.5 * sin(theta) * sin(phi)));
+        }
+    }
+    verts.push_back(Point<N>(0, -0.5, 0));
+
+    const auto ring = [&](int i, int j) {
+        return static_cast<uint32_t>(1 + (i - 1) * segments + j % segments);
+    };
+    const uint32_t bottom = static_cast<uint32_t>(verts.size() - 1);
+    for (int j = 0; j < segments; j++) {
+        faces.push_back(Face{0, ring(1, j + 1), ring(1, j)});
+        faces.push_back(Face{bottom, ring(rings - 1, j), ring(rings - 1, j + 1)});
+    }
+    for (int i = 1; i < rings - 1; i++) {
+        for (int j = 0; j < segments; j++) {
+            faces.push_back(Face{ring(i, j), ring(i, j + 1), ring(i + 1, j + 1)});
+            faces.push_back(Face{ring(i, j), ring(i + 1, j + 1), ring(i + 1, j)});
+        }
+    }
+    return std::make_shared<const Geometry<N>>(VertexArray<N>(verts), std::move(faces));
+}
+
+// count spheres of the given size scattered through a 40 unit cube around the origin
+template <Numeric N>
+void fill_scene(Scene<N>& scene, int count, int rings, int segments) {
+    std::mt19937 rng (SEED);
+    std::uniform_real_distribution<double> pos (-20.0, 20.0);
+    std::uniform_real_distribution<double> size (0.5, 3.0);
+    std::uniform_int_distribution<int> colour (64, 255);
+    const GeometryPtr<N> sphere = make_sphere<N>(rings, segments);
+    for (int i = 0; i < count; i++) {
+        Transform<N> t;
+        t.position = Point<N>(pos(rng), pos(rng), pos(rng));
+        t.scale = size(rng);
+        scene.add_instance(sphere, t, colour(rng), colour(rng), colour(rng));
+    }
+}
+
+// the scripted camera, circling the origin at distance 30 and looking at it
+template <Numeric N = double>
+Mat4<N> camera_path(int frame) {
+    const double angle = frame * 0.05;
+    const Point<N> eye (30.0 * cos(angle), 2.0 * sin(angle * 0.5), 30.0 * sin(angle));
+    // forward is (cos(yaw), 0, -sin(yaw)), point it back at the origin
+    const double yaw = atan2(30.0 * sin(angle), -30.0 * cos(angle));
+    return make_projection_matrix<N>(CAM_FOV, CAM_GAP, CAM_FAR) * make_view_matrix(eye, yaw);
+}
+
+// a wireframe and a solid frame benchmark of count spheres along the camera path, with the
+// pipeline in N
+template <Numeric N>
+void frame_benchmarks(JobSystem& jobs, const std::string& name, int count, int rings, int segments, int frames, std::vector<BenchResult>& results) {
+    Scene<N> scene;
+    fill_scene(scene, count, rings, segments);
+
+    FramePipeline<N> pipeline (jobs);
+    LineBatch batch;
+    results.push_back(run("frame_wire_" + name, frames, [&](int frame) {
+        pipeline.render(scene, camera_path<N>(frame), VIEWPORT);
+        batch.clear();
+        batch.add(pipeline.thread_lines());
+        return static_cast<uint64_t>(batch.segment_count());
+    }));
+
+    Framebuffer fb (VIEWPORT.width, VIEWPORT.height);
+    TileRasterizer tiles (jobs, VIEWPORT.width, VIEWPORT.height);
+    pipeline.set_render_mode(RenderMode::SOLID);
+    results.push_back(run("frame_solid_" + name, frames, [&](int frame) {
+        pipeline.render(scene, camera_path<N>(frame), VIEWPORT);
+        tiles.render(fb, pipeline.thread_triangles(), Framebuffer::pack(0, 0, 0));
+        return static_cast<uint64_t>(pipeline.frame_stats().triangles_drawn) + fb.pixel(VIEWPORT.width / 2, VIEWPORT.height / 2);
+    }));
+}
+
+// what one vertex costs across the arrays a frame streams through
+template <Numeric N>
+std::size_t vertex_bytes() {
+    return 3 * sizeof(N) + sizeof(uint8_t) + 2 * sizeof(int) + sizeof(N);
+}
+
+struct Options {
+    std::string out = "bin/bench_results.csv";
+    std::string compare;
+    double threshold = 0.1;
+    bool quick = false;
+};
+
+bool write_results(const std::string& path, const std::vector<BenchResult>& results) {
+    std::ofstream out (path);
+    if (!out) {
+        return false;
+    }
+    out << "name,iterations,median_ms,p99_ms,checksum\n";
+    for (const BenchResult& r : results) {
+        out << r.name << ',' << r.iterations << ',' << r.median_ms << ',' << r.p99_ms << ',' << r.checksum << '\n';
+    }
+    return static_cast<bool>(out);
+}
+
+// false if anything regressed or the baseline couldn't be read
+bool compare_results(const std::string& path, const std::vector<BenchResult>& results, double threshold) {
+    std::ifstream in (path);
+    if (!in) {
+        std::cerr << "Couldn't open baseline " << path << std::endl;
+        return false;
+    }
+    std::map<std::string, BenchResult> baseline;
+    std::string line;
+    std::getline(in, line); // header
+    while (std::getline(in, line)) {
+        std::stringstream fields (line);
+        BenchResult r;
+        std::string iterations, median, p99, checksum;
+        if (std::getline(fields, r.name, ',') && std::getline(fields, iterations, ',') && std::getline(fields, median, ',')
+            && std::getline(fields, p99, ',') && std::getline(fields, checksum, ',')) {
+            r.iterations = std::atoi(iterations.c_str());
+            r.median_ms = std::atof(median.c_str());
+            r.p99_ms = std::atof(p99.c_str());
+            r.checksum = std::strtoull(checksum.c_str(), nullptr, 10);
+            baseline[r.name] = r;
+        }
+    }
+
+    bool ok = true;
+    std::cout << "\ncompared to " << path << ":\n";
+    for (const BenchResult& r : results) {
+        const auto it = baseline.find(r.name);
+        if (it == baseline.end()) {
+            std::printf("%-24s new\n", r.name.c_str());
+            continue;
+        }
+        const double change = r.median_ms / it->second.median_ms - 1.0;
+        const bool slower = change > threshold;
+        const bool changed = r.checksum != it->second.checksum && r.iterations == it->second.iterations;
+        std::printf("%-24s median %+7.1f%%%s%s\n", r.name.c_str(), change * 100.0, slower ? "  REGRESSION" : "", changed ? "  CHECKSUM CHANGED" : "");
+        ok = ok && !slower && !changed;
+    }
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) {
+            options.out = argv[++i];
+        } else if (arg == "--compare" && i + 1 < argc) {
+            options.compare = argv[++i];
+        } else if (arg == "--threshold" && i + 1 < argc) {
+            options.threshold = std::atof(argv[++i]);
+        } else if (arg == "--quick") {
+            options.quick = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--out results.csv] [--compare baseline.csv] [--threshold 0.1] [--quick]" << std::endl;
+            return 1;
+        }
+    }
+    // --quick is for checking the harness itself, its numbers are too noisy to compare
+    const int scale = options.quick ? 10 : 1;
+
+    std::vector<BenchResult> results;
+
+    // cohen_sutherland_clip and clip_segments on segments scattered around and across the window
+    {
+        std::mt19937 rng (SEED);
+        std::uniform_int_distribution<int> x (-VIEWPORT.width / 2, VIEWPORT.width * 3 / 2);
+        std::uniform_int_distribution<int> y (-VIEWPORT.height / 2, VIEWPORT.height * 3 / 2);
+        // x1,y1,x2,y2 of each segment
+        std::vector<int> segments (4 * 100000);
+        for (std::size_t i = 0; i < segments.size(); i += 2) {
+            segments[i] = x(rng);
+            segments[i + 1] = y(rng);
+        }
+        results.push_back(run("clip_100k_segments", 200 / scale, [&](int) {
+            uint64_t sum = 0;
+            for (std::size_t i = 0; i < segments.size(); i += 4) {
+                const auto c = cohen_sutherland_clip(segments[i], segments[i + 1], segments[i + 2], segments[i + 3], 0, 0, VIEWPORT.width, VIEWPORT.height);
+                if (c) {
+                    const auto& [x1, y1, x2, y2] = c.value();
+                    sum += static_cast<uint64_t>(x1 + y1 + x2 + y2);
+                }
+            }
+            return sum;
+        }));
+
+        SegmentArray batch;
+        for (std::size_t i = 0; i < segments.size(); i += 4) {
+            batch.push_back(segments[i], segments[i + 1], segments[i + 2], segments[i + 3], 0);
+        }
+        SegmentArray survivors;
+        results.push_back(run("clip_batch_100k_segments", 200 / scale, [&](int) {
+            survivors.clear();
+            clip_segments(batch, ClipRect{0, 0, VIEWPORT.width, VIEWPORT.height}, survivors);
+            uint64_t sum = 0;
+            for (std::size_t i = 0; i < survivors.size(); i++) {
+                sum += static_cast<uint64_t>(survivors.x1[i] + survivors.y1[i] + survivors.x2[i] + survivors.y2[i]);
+            }
+            return sum;
+        }));
+    }
+
+    // project_point then scale_point_to_win on clip space points in front of the camera
+    {
+        std::mt19937 rng (SEED);
+        std::uniform_real_distribution<double> xy (-50.0, 50.0);
+        std::uniform_real_distribution<double> w (CAM_GAP, CAM_FAR);
+        std::vector<Vec4<double>> points (1 << 20);
+        for (Vec4<double>& p : points) {
+            p.w = w(rng);
+            p.x = xy(rng) * p.w / 50.0;
+            p.y = xy(rng) * p.w / 50.0;
+            p.z = p.w * 0.5;
+        }
+        results.push_back(run("project_1m_points", 100 / scale, [&](int) {
+            uint64_t sum = 0;
+            for (const Vec4<double>& p : points) {
+                const Point<int> s = scale_point_to_win(project_point(p), VIEWPORT);
+                sum += static_cast<uint64_t>(s.x + s.y);
+            }
+            return sum;
+        }));
+    }
+
+    // Mesh::rotate on 10k meshes sharing one geometry
+    {
+        std::vector<Mesh<double>> meshes;
+        for (int i = 0; i < 10000; i++) {
+            meshes.push_back(MakeCube<double>(Point<double>(i % 100, i / 100, 0), 0.5));
+        }
+        results.push_back(run("rotate_10k_meshes", 200 / scale, [&](int) {
+            uint64_t sum = 0;
+            for (Mesh<double>& m : meshes) {
+                m.rotate(0.01, 0.02, 0.0);
+                sum += static_cast<uint64_t>(m.bounds.max.x * 1000.0);
+            }
+            return sum;
+        }));
+    }
+
+    // whole frames, wireframe and solid, of 1k/100k/1M triangle scenes along the camera path
+    struct SceneSize {
+        const char* name;
+        int count;
+        int rings;
+        int segments;
+        int frames;
+    };
+    const SceneSize sizes[] = {
+        {"1k", 10, 6, 10, 200},        // 10 x 100 faces
+        {"100k", 100, 21, 25, 60},     // 100 x 1000 faces
+        {"1m", 1000, 21, 25, 20},      // 1000 x 1000 faces
+    };
+    JobSystem jobs;
+    for (const SceneSize& size : sizes) {
+        frame_benchmarks<double>(jobs, size.name, size.count, size.rings, size.segments, std::max(size.frames / scale, 2), results);
+    }
+
+    // the 100k scene again with the pipeline in float and in 16.16 fixed point
+    const SceneSize& mid = sizes[1];
+    frame_benchmarks<float>(jobs, std::string(mid.name) + "_float", mid.count, mid.rings, mid.segments, std::max(mid.frames / scale, 2), results);
+    frame_benchmarks<Fixed>(jobs, std::string(mid.name) + "_fixed", mid.count, mid.rings, mid.segments, std::max(mid.frames / scale, 2), results);
+
+    // the 100k scene with the camera standing still, every frame after the first keeps the last
+    // one's output and submits it again
+    {
+        Scene<double> scene;
+        fill_scene(scene, mid.count, mid.rings, mid.segments);
+        FramePipeline<double> pipeline (jobs);
+        LineBatch batch;
+        results.push_back(run("frame_static_100k", std::max(mid.frames / scale, 2), [&](int) {
+            pipeline.render(scene, camera_path<double>(0), VIEWPORT);
+            if (!pipeline.reused_last_frame()) {
+                batch.clear();
+                batch.add(pipeline.thread_lines());
+            }
+            return static_cast<uint64_t>(batch.segment_count());
+        }));
+    }
+    std::cout << "bytes per vertex (model space + outcode + window space): double " << vertex_bytes<double>()
+        << ", float " << vertex_bytes<float>() << ", fixed " << vertex_bytes<Fixed>() << '\n';
+
+    std::cout << jobs.thread_count() << " threads, " << simd_level_name(detect_simd_level()) << " kernels\n";
+    if (!write_results(options.out, results)) {
+        std::cerr << "Couldn't write " << options.out << std::endl;
+        return 1;
+    }
+    std::cout << "results written to " << options.out << '\n';
+    if (!options.compare.empty() && !compare_results(options.compare, results, options.threshold)) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,129 @@
+// vertices transformed per second: the old per-vertex polar rotation vs the per-frame view-projection matrix,
+// applied one AoS Point at a time and as batched SoA kernels
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include "../include/Triangle.hpp"
+#include "../include/Camera.hpp"
+#include "../include/VertexArray.hpp"
+#include "../include/Simd.hpp"
+#include "../include/Fixed.hpp"
+
+constexpr int VERTICES = 1 << 20;
+constexpr int FRAMES = 20;
+constexpr double CAM_FOV = PI/2.0;
+constexpr double CAM_GAP = 0.1;
+constexpr double CAM_FAR = 100.0;
+constexpr Viewport VIEWPORT {1080, 720};
+
+double fix_angle(double angle) {
+    if (angle < 0) {
+        return angle = 2*PI + angle;
+    } else if (angle > 2*PI) {
+        angle = fmodl(angle, 2.0*PI);
+    }
+    return angle;
+}
+
+// the transform main.cpp used to run on every vertex
+Point<int> legacy_transform(Point<double> p, const Point<double>& player, double camera) {
+    p -= player;
+
+    const double r_xz = sqrtl(powl(p.x, 2) + powl(p.z, 2));
+    const double a0_xz = fix_angle(camera - PI/2.0 + atan2l(p.z, p.x));
+    p.x = r_xz * cosl(a0_xz);
+    p.z = r_xz * sinl(a0_xz);
+
+    const double f = 1.0 / tanl(CAM_FOV / 2.0);
+    p.x = f * p.x / p.z;
+    p.y = f * p.y / p.z;
+
+    return Point<int> (
+        (VIEWPORT.width/2.0) * p.x + (VIEWPORT.width/2.0),
+        VIEWPORT.height - ((VIEWPORT.height/2.0) * p.y + (VIEWPORT.height/2.0)),
+        p.z
+    );
+}
+
+template <typename V, typename F>
+double vertices_per_second(const V& verts, F transform) {
+    long long checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < FRAMES; frame++) {
+        const double camera = frame * 0.05;
+        const Point<double> player (0.01 * frame, 0.0, 0.0);
+        checksum += transform(verts, player, camera);
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    // keep the work observable so it can't be optimised away
+    if (checksum == 42) {
+        std::cout << ' ';
+    }
+    return static_cast<double>(verts.size()) * FRAMES / elapsed.count();
+}
+
+// the fused SoA kernel with vertices and window space in N, outcodes included
+template <Numeric N>
+double batched_vertices_per_second(const std::vector<Point<double>>& verts) {
+    VertexArray<N> soa;
+    for (const Point<double>& v : verts) {
+        soa.push_back(static_cast<Point<N>>(v));
+    }
+    return vertices_per_second(soa, [](const VertexArray<N>& vs, const Point<double>& player, double camera) {
+        static std::vector<uint8_t> codes;
+        static ScreenArray<N> screen;
+        codes.resize(vs.padded_size());
+        const Mat4<N> view_proj = make_projection_matrix<N>(CAM_FOV, CAM_GAP, CAM_FAR) * make_view_matrix(static_cast<Point<N>>(player), camera);
+        transform_to_window(vs, view_proj, VIEWPORT.width, VIEWPORT.height, codes.data(), screen);
+        long long sum = 0;
+        for (std::size_t i = 0; i < vs.size(); i++) {
+            sum += screen.x[i] + screen.y[i];
+        }
+        return sum;
+    });
+}
+
+int main() {
+    std::mt19937 rng (1234);
+    std::uniform_real_distribution<double> dist (-10.0, 10.0);
+
+    std::vector<Point<double>> verts;
+    verts.reserve(VERTICES);
+    for (int i = 0; i < VERTICES; i++) {
+        verts.emplace_back(dist(rng), dist(rng), dist(rng));
+    }
+
+    const double before = vertices_per_second(verts, [](const std::vector<Point<double>>& vs, const Point<double>& player, double camera) {
+        long long sum = 0;
+        for (const Point<double>& v : vs) {
+            const Point<int> p = legacy_transform(v, player, camera);
+            sum += p.x + p.y;
+        }
+        return sum;
+    });
+
+    const double after = vertices_per_second(verts, [](const std::vector<Point<double>>& vs, const Point<double>& player, double camera) {
+        const Mat4<double> view_proj = make_projection_matrix<double>(CAM_FOV, CAM_GAP, CAM_FAR) * make_view_matrix(player, camera);
+        long long sum = 0;
+        for (const Point<double>& v : vs) {
+            const Point<int> p = scale_point_to_win(project_point(view_proj.transform(v)), VIEWPORT);
+            sum += p.x + p.y;
+        }
+        return sum;
+    });
+
+    const double batched = batched_vertices_per_second<double>(verts);
+    const double batched_float = batched_vertices_per_second<float>(verts);
+    const double batched_fixed = batched_vertices_per_second<Fixed>(verts);
+
+    std::cout << "polar per-vertex:  " << before / 1e6 << " Mverts/s\n";
+    std::cout << "view-proj matrix:  " << after / 1e6 << " Mverts/s\n";
+    std::cout << "soa " << simd_level_name(detect_simd_level()) << " kernels: " << batched / 1e6 << " Mverts/s\n";
+    std::cout << "soa float kernels: " << batched_float / 1e6 << " Mverts/s\n";
+    std::cout << "soa fixed (scalar): " << batched_fixed / 1e6 << " Mverts/s\n";
+    std::cout << "speedup:           " << after / before << "x (matrix), " << batched / before << "x (soa)\n";
+    return 0;
+}
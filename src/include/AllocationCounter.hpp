@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstddef>
+
+// counts calls to the global operator new, for checking that steady state frames never touch the
+// heap. build with -DENGINE_COUNT_ALLOCATIONS to replace operator new and delete, without it
+// heap_allocations() always reads zero and the default allocator is left alone.
+// the replacements are ordinary (not inline) definitions, so only one translation unit of a
+// program may include this header.
+
+inline std::atomic<std::size_t> heap_allocation_counter {0};
+
+// operator new calls since the program started, from every thread
+inline std::size_t heap_allocations() {
+    return heap_allocation_counter.load(std::memory_order_relaxed);
+}
+
+#ifdef ENGINE_COUNT_ALLOCATIONS
+namespace allocation_counter {
+
+inline void* counted_alloc(std::size_t n, std::size_t align) {
+    heap_allocation_counter.fetch_add(1, std::memory_order_relaxed);
+    n = n == 0 ? 1 : n;
+    if (align <= alignof(std::max_align_t)) {
+        return std::malloc(n);
+    }
+    // aligned_alloc wants the size in whole multiples of the alignment
+    return std::aligned_alloc(align, (n + align - 1) / align * align);
+}
+
+inline void* counted_new(std::size_t n, std::size_t align) {
+    void* p = counted_alloc(n, align);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+}
+
+void* operator new(std::size_t n) {
+    return allocation_counter::counted_new(n, 0);
+}
+
+void* operator new[](std::size_t n) {
+    return allocation_counter::counted_new(n, 0);
+}
+
+void* operator new(std::size_t n, std::align_val_t a) {
+    return allocation_counter::counted_new(n, static_cast<std::size_t>(a));
+}
+
+void* operator new[](std::size_t n, std::align_val_t a) {
+    return allocation_counter::counted_new(n, static_cast<std::size_t>(a));
+}
+
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept {
+    return allocation_counter::counted_alloc(n, 0);
+}
+
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept {
+    return allocation_counter::counted_alloc(n, 0);
+}
+
+void* operator new(std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept {
+    return allocation_counter::counted_alloc(n, static_cast<std::size_t>(a));
+}
+
+void* operator new[](std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept {
+    return allocation_counter::counted_alloc(n, static_cast<std::size_t>(a));
+}
+
+// malloc, aligned_alloc and free pair up whatever the size or alignment, so every delete is free()
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+#endif
@@ -0,0 +1,91 @@
+#pragma once
+#include <cmath>
+#include <algorithm>
+#include <cstddef>
+#include "Point.hpp"
+#include "Matrix.hpp"
+#include "VertexArray.hpp"
+
+// axis aligned box and bounding sphere around a set of vertices
+template <Numeric N>
+struct Bounds {
+    Point<N> min {0, 0, 0};
+    Point<N> max {0, 0, 0};
+
+    Point<N> centre {0, 0, 0};
+    N radius = 0;
+
+    void translate(const Point<N>& t) {
+        min += t;
+        max += t;
+        centre += t;
+    }
+
+    // uniform scale about origin
+    void scale(const Point<N>& origin, N s) {
+        const auto about = [&](Point<N> p) {
+            p -= origin;
+            p *= Point<N>(s, s, s);
+            p += origin;
+            return p;
+        };
+        const Point<N> a = about(min);
+        const Point<N> b = about(max);
+        min = Point<N>(std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z));
+        max = Point<N>(std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z));
+        centre = about(centre);
+        radius *= s < 0 ? -s : s;
+    }
+};
+
+// tight box, sphere centred on the box
+template <Numeric N>
+Bounds<N> compute_bounds(const VertexArray<N>& v) {
+    Bounds<N> b;
+    if (v.size() == 0) {
+        return b;
+    }
+
+    b.min = v[0];
+    b.max = v[0];
+    for (std::size_t i = 1; i < v.size(); i++) {
+        b.min.x = std::min(b.min.x, v.x[i]);
+        b.min.y = std::min(b.min.y, v.y[i]);
+        b.min.z = std::min(b.min.z, v.z[i]);
+        b.max.x = std::max(b.max.x, v.x[i]);
+        b.max.y = std::max(b.max.y, v.y[i]);
+        b.max.z = std::max(b.max.z, v.z[i]);
+    }
+
+    b.centre = Point<N>((b.min.x + b.max.x) / 2, (b.min.y + b.max.y) / 2, (b.min.z + b.max.z) / 2);
+    N r2 = 0;
+    for (std::size_t i = 0; i < v.size(); i++) {
+        const N dx = v.x[i] - b.centre.x;
+        const N dy = v.y[i] - b.centre.y;
+        const N dz = v.z[i] - b.centre.z;
+        r2 = std::max(r2, dx*dx + dy*dy + dz*dz);
+    }
+    b.radius = num_sqrt(r2);
+    return b;
+}
+
+// b moved by m, a box around the eight transformed corners and the sphere's centre moved with
+// its radius scaled by scale. not as tight as refitting the transformed vertices, but O(1).
+template <Numeric N>
+Bounds<N> transform_bounds(const Bounds<N>& b, const Mat4<N>& m, N scale) {
+    Bounds<N> r;
+    for (int i = 0; i < 8; i++) {
+        const Point<N> corner (i & 1 ? b.max.x : b.min.x, i & 2 ? b.max.y : b.min.y, i & 4 ? b.max.z : b.min.z);
+        const Vec4<N> v = m.transform(corner);
+        if (i == 0) {
+            r.min = Point<N>(v.x, v.y, v.z);
+            r.max = r.min;
+        }
+        r.min = Point<N>(std::min(r.min.x, v.x), std::min(r.min.y, v.y), std::min(r.min.z, v.z));
+        r.max = Point<N>(std::max(r.max.x, v.x), std::max(r.max.y, v.y), std::max(r.max.z, v.z));
+    }
+    const Vec4<N> c = m.transform(b.centre);
+    r.centre = Point<N>(c.x, c.y, c.z);
+    r.radius = b.radius * (scale < 0 ? -scale : scale);
+    return r;
+}
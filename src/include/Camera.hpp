@@ -0,0 +1,100 @@
+#pragma once
+#include <cmath>
+#include "Point.hpp"
+#include "Matrix.hpp"
+#include "VertexArray.hpp"
+
+// world -> view space. the camera sits at player and yaws around the y axis,
+// camera angle 0 faces east (+x) and angles increase anticlockwise seen from above.
+// view space looks down +z with +x to the right and +y up.
+template <Numeric N>
+Mat4<N> make_view_matrix(const Point<N>& player, double camera) {
+    const N c = static_cast<N>(cos(camera));
+    const N s = static_cast<N>(sin(camera));
+
+    // basis vectors of the camera in world space
+    const Point<N> right (-s, 0, -c);
+    const Point<N> up (0, 1, 0);
+    const Point<N> forward (c, 0, -s);
+
+    Mat4<N> r = Mat4<N>::identity();
+    r.m[0][0] = right.x;   r.m[0][1] = right.y;   r.m[0][2] = right.z;
+    r.m[1][0] = up.x;      r.m[1][1] = up.y;      r.m[1][2] = up.z;
+    r.m[2][0] = forward.x; r.m[2][1] = forward.y; r.m[2][2] = forward.z;
+
+    // translate by -player after rotating the basis
+    r.m[0][3] = -(right.x*player.x + right.y*player.y + right.z*player.z);
+    r.m[1][3] = -(up.x*player.x + up.y*player.y + up.z*player.z);
+    r.m[2][3] = -(forward.x*player.x + forward.y*player.y + forward.z*player.z);
+    return r;
+}
+
+// view -> clip space. w takes the view depth so the perspective divide happens in project_point,
+// z maps [near, far] onto [0, 1] after the divide
+template <Numeric N>
+Mat4<N> make_projection_matrix(double fov, double near, double far) {
+    const N f = static_cast<N>(1.0 / tan(fov / 2.0));
+
+    Mat4<N> r;
+    r.m[0][0] = f;
+    r.m[1][1] = f;
+    r.m[2][2] = static_cast<N>(far / (far - near));
+    r.m[2][3] = static_cast<N>(-far * near / (far - near));
+    r.m[3][2] = 1;
+    return r;
+}
+
+// world space position of the eye behind a perspective view-projection matrix, the one point
+// that lands on x = y = w = 0 in clip space
+template <Numeric N>
+Point<N> eye_position(const Mat4<N>& view_proj) {
+    const int rows[3] = {0, 1, 3};
+    double a[3][3];
+    double t[3];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            a[i][j] = static_cast<double>(view_proj.m[rows[i]][j]);
+        }
+        t[i] = -static_cast<double>(view_proj.m[rows[i]][3]);
+    }
+
+    // Cramer's rule
+    const auto det = [](const double (&m)[3][3]) {
+        return m[0][0] * (m[1][1]*m[2][2] - m[1][2]*m[2][1])
+            - m[0][1] * (m[1][0]*m[2][2] - m[1][2]*m[2][0])
+            + m[0][2] * (m[1][0]*m[2][1] - m[1][1]*m[2][0]);
+    };
+    const double d = det(a);
+    double p[3];
+    for (int j = 0; j < 3; j++) {
+        double m[3][3];
+        for (int i = 0; i < 3; i++) {
+            for (int k = 0; k < 3; k++) {
+                m[i][k] = k == j ? t[i] : a[i][k];
+            }
+        }
+        p[j] = det(m) / d;
+    }
+    return Point<N>(p[0], p[1], p[2]);
+}
+
+// clip space -> normalized device coordinates (perspective divide)
+template <Numeric N>
+Point<N> project_point(const Vec4<N>& p) {
+    return Point<N>(p.x / p.w, p.y / p.w, p.z / p.w);
+}
+
+struct Viewport {
+    int width;
+    int height;
+};
+
+// normalized device coordinates -> window pixels and fixed point depth
+template <Numeric N>
+Point<int> scale_point_to_win(const Point<N>& p, const Viewport& vp) {
+    return Point<int> (
+        static_cast<int>((vp.width/2.0) * p.x + (vp.width/2.0)),
+        static_cast<int>(vp.height - ((vp.height/2.0) * p.y + (vp.height/2.0))), // flip vertically
+        depth_to_fixed(p.z)
+    );
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include "Point.hpp"
+#include "Matrix.hpp"
+#include "VertexArray.hpp"
+
+// homogeneous clipping, run before the perspective divide. inside the view frustum means
+// -w <= x <= w, -w <= y <= w and 0 <= z <= w (z is 0 on the near plane and w on the far plane).
+
+enum ClipCode : uint8_t {
+    CLIP_LEFT = 0b0000001,
+    CLIP_RIGHT = 0b0000010,
+    CLIP_BOTTOM = 0b0000100,
+    CLIP_TOP = 0b0001000,
+    CLIP_NEAR = 0b0010000,
+    CLIP_FAR = 0b0100000,
+
+    // outside the x/y guard band, the window space position may not fit the 2D clipper's ints
+    CLIP_GUARD = 0b1000000
+};
+
+// vertices only get clipped in x/y once they are this many half-screens off centre, anything
+// closer is left for the 2D clipper
+constexpr double GUARD_BAND = 16.0;
+
+// planes that need clipping in clip space, the rest only matter for rejection
+constexpr uint8_t CLIP_BEFORE_DIVIDE = CLIP_NEAR | CLIP_FAR | CLIP_GUARD;
+
+template <Numeric N>
+uint8_t clip_outcode(N x, N y, N z, N w) {
+    uint8_t code = 0;
+    if (x < -w) {
+        code |= CLIP_LEFT;
+    } else if (x > w) {
+        code |= CLIP_RIGHT;
+    }
+    if (y < -w) {
+        code |= CLIP_BOTTOM;
+    } else if (y > w) {
+        code |= CLIP_TOP;
+    }
+    if (z < 0) {
+        code |= CLIP_NEAR;
+    } else if (z > w) {
+        code |= CLIP_FAR;
+    }
+
+    const N g = static_cast<N>(GUARD_BAND) * w;
+    if (x < -g || x > g || y < -g || y > g) {
+        code |= CLIP_GUARD;
+    }
+    return code;
+}
+
+// Liang-Barsky against the near, far and guard band planes. a and b are moved onto the planes
+// they cross, returns false if none of the segment is left.
+template <Numeric N>
+bool clip_segment(Vec4<N>& a, Vec4<N>& b) {
+    const N g = static_cast<N>(GUARD_BAND);
+
+    // signed distances to each plane, inside is >= 0
+    const N da[6] = {a.z, a.w - a.z, g*a.w + a.x, g*a.w - a.x, g*a.w + a.y, g*a.w - a.y};
+    const N db[6] = {b.z, b.w - b.z, g*b.w + b.x, g*b.w - b.x, g*b.w + b.y, g*b.w - b.y};
+
+    N t0 = 0;
+    N t1 = 1;
+    for (int i = 0; i < 6; i++) {
+        if (da[i] < 0 && db[i] < 0) {
+            return false;
+        } else if (da[i] < 0) {
+            t0 = std::max(t0, da[i] / (da[i] - db[i]));
+        } else if (db[i] < 0) {
+            t1 = std::min(t1, da[i] / (da[i] - db[i]));
+        }
+    }
+    if (t0 > t1) {
+        return false;
+    }
+
+    const Vec4<N> d (b.x - a.x, b.y - a.y, b.z - a.z, b.w - a.w);
+    const Vec4<N> a0 = a;
+    a = Vec4<N>(a0.x + t0*d.x, a0.y + t0*d.y, a0.z + t0*d.z, a0.w + t0*d.w);
+    b = Vec4<N>(a0.x + t1*d.x, a0.y + t1*d.y, a0.z + t1*d.z, a0.w + t1*d.w);
+    return true;
+}
+
+// most vertices a triangle can have after clip_polygon, one more per plane it crosses
+constexpr int CLIP_POLYGON_MAX = 9;
+
+// Sutherland-Hodgman against the same planes as clip_segment. poly holds count vertices and is
+// clipped in place, returns the new count (0 if nothing is left, otherwise at least 3).
+template <Numeric N>
+int clip_polygon(Vec4<N> (&poly)[CLIP_POLYGON_MAX], int count) {
+    const N g = static_cast<N>(GUARD_BAND);
+    const auto distance = [g](const Vec4<N>& v, int plane) -> N {
+        switch (plane) {
+            case 0: return v.z;
+            case 1: return v.w - v.z;
+            case 2: return g*v.w + v.x;
+            case 3: return g*v.w - v.x;
+            case 4: return g*v.w + v.y;
+            default: return g*v.w - v.y;
+        }
+    };
+
+    Vec4<N> out[CLIP_POLYGON_MAX];
+    for (int plane = 0; plane < 6 && count > 0; plane++) {
+        int n = 0;
+        for (int i = 0; i < count; i++) {
+            const Vec4<N>& a = poly[i];
+            const Vec4<N>& b = poly[(i + 1) % count];
+            const N da = distance(a, plane);
+            const N db = distance(b, plane);
+            if (da >= 0) {
+                out[n++] = a;
+            }
+            if ((da >= 0) != (db >= 0) && n < CLIP_POLYGON_MAX) {
+                const N t = da / (da - db);
+                out[n++] = Vec4<N>(a.x + t*(b.x - a.x), a.y + t*(b.y - a.y), a.z + t*(b.z - a.z), a.w + t*(b.w - a.w));
+            }
+        }
+        count = n;
+        std::copy(out, out + n, poly);
+    }
+    return count >= 3 ? count : 0;
+}
@@ -5,6 +5,7 @@
 #include <cmath>
 #include <algorithm>
 #include <optional>
+#include <tuple>
 
 // defining region codes
 enum OutCode {
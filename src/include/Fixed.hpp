@@ -0,0 +1,163 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <compare>
+#include <type_traits>
+#include <iostream>
+#include "Point.hpp"
+
+// signed fixed point number, an int32_t counting 2^-FRAC_BITS steps. converts implicitly from
+// any built in arithmetic type so it can stand in for N wherever the templates mix in literals,
+// and only explicitly back out. results that don't fit saturate at the ends of the range rather
+// than wrapping, dividing by zero included, so a vertex far off screen or behind the eye can't
+// turn into garbage or a trap.
+template <int FRAC_BITS>
+class FixedPoint {
+public:
+    static_assert(FRAC_BITS > 0 && FRAC_BITS < 31);
+
+    static constexpr int32_t ONE = int32_t{1} << FRAC_BITS;
+
+    constexpr FixedPoint() : raw{0} {}
+
+    template <typename T>
+        requires std::is_arithmetic_v<T>
+    constexpr FixedPoint(T v) : raw{from(v)} {}
+
+    static constexpr FixedPoint from_raw(int32_t r) {
+        FixedPoint f;
+        f.raw = r;
+        return f;
+    }
+
+    constexpr int32_t raw_value() const {
+        return raw;
+    }
+
+    // integers truncate towards zero like a float would
+    template <typename T>
+        requires std::is_arithmetic_v<T>
+    explicit constexpr operator T() const {
+        if constexpr (std::is_floating_point_v<T>) {
+            return static_cast<T>(raw) / ONE;
+        } else {
+            return static_cast<T>(raw / ONE);
+        }
+    }
+
+    constexpr FixedPoint operator-() const {
+        return from_raw(saturate(-static_cast<int64_t>(raw)));
+    }
+
+    constexpr FixedPoint operator+() const {
+        return *this;
+    }
+
+    friend constexpr FixedPoint operator+(FixedPoint a, FixedPoint b) {
+        return from_raw(saturate(static_cast<int64_t>(a.raw) + b.raw));
+    }
+
+    friend constexpr FixedPoint operator-(FixedPoint a, FixedPoint b) {
+        return from_raw(saturate(static_cast<int64_t>(a.raw) - b.raw));
+    }
+
+    friend constexpr FixedPoint operator*(FixedPoint a, FixedPoint b) {
+        return from_raw(saturate((static_cast<int64_t>(a.raw) * b.raw) >> FRAC_BITS));
+    }
+
+    friend constexpr FixedPoint operator/(FixedPoint a, FixedPoint b) {
+        if (b.raw == 0) {
+            return from_raw(a.raw < 0 ? std::numeric_limits<int32_t>::min() : std::numeric_limits<int32_t>::max());
+        }
+        return from_raw(saturate(static_cast<int64_t>(a.raw) * ONE / b.raw));
+    }
+
+    constexpr FixedPoint& operator+=(FixedPoint rhs) {
+        return *this = *this + rhs;
+    }
+
+    constexpr FixedPoint& operator-=(FixedPoint rhs) {
+        return *this = *this - rhs;
+    }
+
+    constexpr FixedPoint& operator*=(FixedPoint rhs) {
+        return *this = *this * rhs;
+    }
+
+    constexpr FixedPoint& operator/=(FixedPoint rhs) {
+        return *this = *this / rhs;
+    }
+
+    friend constexpr bool operator==(FixedPoint a, FixedPoint b) {
+        return a.raw == b.raw;
+    }
+
+    friend constexpr std::strong_ordering operator<=>(FixedPoint a, FixedPoint b) {
+        return a.raw <=> b.raw;
+    }
+
+    friend std::ostream& operator<<(std::ostream& out, FixedPoint f) {
+        return out << static_cast<double>(f);
+    }
+
+private:
+    int32_t raw;
+
+    static constexpr int32_t saturate(int64_t v) {
+        if (v > std::numeric_limits<int32_t>::max()) {
+            return std::numeric_limits<int32_t>::max();
+        }
+        if (v < std::numeric_limits<int32_t>::min()) {
+            return std::numeric_limits<int32_t>::min();
+        }
+        return static_cast<int32_t>(v);
+    }
+
+    template <typename T>
+    static constexpr int32_t from(T v) {
+        if constexpr (std::is_floating_point_v<T>) {
+            const double scaled = static_cast<double>(v) * ONE;
+            if (!(scaled < 2147483647.0)) {
+                return scaled != scaled ? 0 : std::numeric_limits<int32_t>::max();
+            }
+            if (!(scaled > -2147483648.0)) {
+                return std::numeric_limits<int32_t>::min();
+            }
+            // round to nearest
+            return static_cast<int32_t>(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+        } else {
+            return saturate(static_cast<int64_t>(v) * ONE);
+        }
+    }
+};
+
+template <int FRAC_BITS>
+inline constexpr bool is_fixed_point_v<FixedPoint<FRAC_BITS>> = true;
+
+// 16.16, +-32768 at a precision of 1/65536. enough for world and clip space coordinates of a
+// scene within the far plane and for normalized depth at 16 bits.
+using Fixed = FixedPoint<16>;
+
+// bit by bit integer square root of the raw value shifted up by FRAC_BITS, exact to the last bit
+template <int FRAC_BITS>
+FixedPoint<FRAC_BITS> num_sqrt(FixedPoint<FRAC_BITS> v) {
+    if (v.raw_value() <= 0) {
+        return FixedPoint<FRAC_BITS>();
+    }
+    uint64_t n = static_cast<uint64_t>(v.raw_value()) << FRAC_BITS;
+    uint64_t root = 0;
+    uint64_t bit = uint64_t{1} << 62;
+    while (bit > n) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (n >= root + bit) {
+            n -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return FixedPoint<FRAC_BITS>::from_raw(static_cast<int32_t>(root));
+}
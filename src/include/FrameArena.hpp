@@ -0,0 +1,76 @@
+#pragma once
+#include <vector>
+#include <new>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
+#include <cstddef>
+
+// bump allocator for memory that only lives for one frame. allocate() hands out slices of one
+// block and reset() takes them all back at once, nothing is freed individually and destructors
+// never run, so only trivially destructible types go in here.
+// a frame that needs more than the block spills into extra blocks, the next reset() replaces
+// everything with a single block big enough for that frame so steady state frames never touch
+// the heap.
+class FrameArena {
+public:
+    static constexpr std::size_t ALIGN = 64;
+
+    explicit FrameArena(std::size_t capacity = 1 << 20) {
+        grow(capacity);
+    }
+
+    // n uninitialized Ts, aligned to ALIGN
+    template <typename T>
+    T* allocate(std::size_t n) {
+        static_assert(std::is_trivially_destructible_v<T>);
+        static_assert(alignof(T) <= ALIGN);
+        const std::size_t bytes = (n * sizeof(T) + ALIGN - 1) / ALIGN * ALIGN;
+        used += bytes;
+        if (offset + bytes > capacity) {
+            // this frame outgrew the block, spill and size up on reset
+            spill.emplace_back(static_cast<std::byte*>(::operator new(bytes, std::align_val_t{ALIGN})));
+            return reinterpret_cast<T*>(spill.back().get());
+        }
+        T* p = reinterpret_cast<T*>(block.get() + offset);
+        offset += bytes;
+        return p;
+    }
+
+    // release everything allocated since the last reset
+    void reset() {
+        if (!spill.empty()) {
+            spill.clear();
+            grow(used + used / 2);
+        }
+        offset = 0;
+        used = 0;
+    }
+
+    std::size_t bytes_used() const {
+        return used;
+    }
+
+    std::size_t bytes_reserved() const {
+        return capacity;
+    }
+
+private:
+    struct Free {
+        void operator()(std::byte* p) const {
+            ::operator delete(p, std::align_val_t{ALIGN});
+        }
+    };
+    using Block = std::unique_ptr<std::byte[], Free>;
+
+    Block block;
+    std::size_t capacity = 0;
+    std::size_t offset = 0;
+    std::size_t used = 0; // including spilled blocks
+    std::vector<Block> spill;
+
+    void grow(std::size_t bytes) {
+        capacity = std::max<std::size_t>((bytes + ALIGN - 1) / ALIGN * ALIGN, ALIGN);
+        block.reset(static_cast<std::byte*>(::operator new(capacity, std::align_val_t{ALIGN})));
+    }
+};
@@ -0,0 +1,152 @@
+#pragma once
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+#include <cstddef>
+
+// how the main loop waits between frames. VSYNC leaves it to a presenting backend that blocks on
+// the display's refresh, TARGET_FPS paces frames itself and UNCAPPED never waits.
+enum class PacingMode {
+    VSYNC,
+    TARGET_FPS,
+    UNCAPPED
+};
+
+// frame to frame intervals as seen by the pacer
+struct FrameTimeStats {
+    std::size_t frames = 0; // the most recent FramePacer::MAX_SAMPLES at most
+    double mean_ms = 0;
+    double jitter_ms = 0; // standard deviation of the interval
+    double p99_ms = 0;
+    double max_ms = 0;
+};
+
+// call wait() once per frame after presenting. in TARGET_FPS mode it sleeps until shortly before
+// the frame's deadline, since the OS may oversleep by a millisecond or more, then spins the rest
+// of the way. deadlines advance by exactly one period so small delays don't add up, a frame that
+// misses its deadline by more than a period starts the schedule over from now.
+class FramePacer {
+public:
+    // how long before the deadline to stop sleeping and start spinning
+    static constexpr std::chrono::microseconds SPIN_MARGIN {1500};
+
+    // intervals kept for the stats, older ones are overwritten so wait() never allocates
+    static constexpr std::size_t MAX_SAMPLES = 1 << 16;
+
+    FramePacer(PacingMode mode, double target_fps)
+        : mode{mode},
+          period{std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / std::max(target_fps, 1.0)))},
+          last{clock::now()}, deadline{last + period} {
+        intervals.reserve(MAX_SAMPLES);
+    }
+
+    PacingMode pacing_mode() const {
+        return mode;
+    }
+
+    void wait() {
+        if (mode == PacingMode::TARGET_FPS) {
+            const clock::time_point now = clock::now();
+            if (now - deadline > period) {
+                deadline = now;
+            } else {
+                if (deadline - now > SPIN_MARGIN) {
+                    std::this_thread::sleep_until(deadline - SPIN_MARGIN);
+                }
+                while (clock::now() < deadline) {
+                    std::this_thread::yield();
+                }
+            }
+            deadline += period;
+        }
+
+        const clock::time_point now = clock::now();
+        const double ms = std::chrono::duration<double, std::milli>(now - last).count();
+        if (intervals.size() < MAX_SAMPLES) {
+            intervals.push_back(ms);
+        } else {
+            intervals[next_sample] = ms;
+            next_sample = (next_sample + 1) % MAX_SAMPLES;
+        }
+        last = now;
+    }
+
+    FrameTimeStats frame_time_stats() const {
+        FrameTimeStats s;
+        s.frames = intervals.size();
+        if (intervals.empty()) {
+            return s;
+        }
+        double sum = 0;
+        for (double ms : intervals) {
+            sum += ms;
+        }
+        s.mean_ms = sum / intervals.size();
+        double variance = 0;
+        for (double ms : intervals) {
+            variance += (ms - s.mean_ms) * (ms - s.mean_ms);
+        }
+        s.jitter_ms = std::sqrt(variance / intervals.size());
+
+        std::vector<double> sorted = intervals;
+        std::sort(sorted.begin(), sorted.end());
+        s.p99_ms = sorted[static_cast<std::size_t>(std::ceil(0.99 * sorted.size())) - 1];
+        s.max_ms = sorted.back();
+        return s;
+    }
+
+    void write_report(std::ostream& out) const {
+        const FrameTimeStats s = frame_time_stats();
+        out << "frame time " << s.mean_ms << " ms mean, " << s.jitter_ms << " ms jitter (std dev), "
+            << s.p99_ms << " ms p99, " << s.max_ms << " ms max over " << s.frames << " frames" << std::endl;
+    }
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    PacingMode mode;
+    clock::duration period;
+    clock::time_point last;
+    clock::time_point deadline;
+    std::vector<double> intervals;
+    std::size_t next_sample = 0; // oldest interval once intervals is full
+};
+
+// turns real frame times into a whole number of fixed simulation steps. the remainder carries
+// over to the next frame and alpha() says how far between the last two steps the frame falls, for
+// interpolating what gets drawn.
+class FixedTimestep {
+public:
+    // a frame longer than this many steps drops the excess rather than trying to catch up
+    static constexpr int MAX_STEPS = 8;
+
+    explicit FixedTimestep(double step_seconds) : step{step_seconds} {}
+
+    double step_seconds() const {
+        return step;
+    }
+
+    // steps to simulate for a frame that took frame_seconds
+    int advance(double frame_seconds) {
+        accumulator += frame_seconds;
+        int steps = static_cast<int>(accumulator / step);
+        if (steps > MAX_STEPS) {
+            steps = MAX_STEPS;
+            accumulator = 0;
+        } else {
+            accumulator -= steps * step;
+        }
+        return steps;
+    }
+
+    double alpha() const {
+        return accumulator / step;
+    }
+
+private:
+    double step;
+    double accumulator = 0;
+};
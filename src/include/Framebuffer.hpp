@@ -0,0 +1,106 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstddef>
+#include "VertexArray.hpp"
+
+// RGBA8 pixels plus a fixed point depth buffer, row major with y down like the SDL window.
+// rows are stride pixels long and both sizes are padded to whole RASTER_BLOCKs so block kernels
+// can read and write a full block at the right and bottom edges without bounds checks. rows also
+// start on a cache line, so threads filling side by side tiles never share one.
+constexpr int RASTER_BLOCK = 8;
+constexpr int FRAMEBUFFER_ROW_ALIGN = 16; // pixels, 64 bytes
+
+template <typename T>
+using FramebufferVector = std::vector<T, AlignedAllocator<T, FRAMEBUFFER_ROW_ALIGN * sizeof(uint32_t)>>;
+
+struct Framebuffer {
+    int width;
+    int height;
+    int stride;
+    FramebufferVector<uint32_t> pixels;
+    FramebufferVector<uint32_t> depth;
+
+    Framebuffer(int width, int height)
+        : width{width}, height{height}, stride{padded(width, FRAMEBUFFER_ROW_ALIGN)},
+          pixels(static_cast<std::size_t>(stride) * padded(height, RASTER_BLOCK)),
+          depth(static_cast<std::size_t>(stride) * padded(height, RASTER_BLOCK), DEPTH_MAX) {}
+
+    static uint32_t pack(int red, int green, int blue) {
+        return static_cast<uint32_t>(red & 0xff) | (static_cast<uint32_t>(green & 0xff) << 8) | (static_cast<uint32_t>(blue & 0xff) << 16) | 0xff000000u;
+    }
+
+    uint32_t& pixel(int x, int y) {
+        return pixels[static_cast<std::size_t>(y) * stride + x];
+    }
+
+    uint32_t pixel(int x, int y) const {
+        return pixels[static_cast<std::size_t>(y) * stride + x];
+    }
+
+    // colour only, the depth buffer is left alone
+    void fill(uint32_t colour) {
+        std::fill(pixels.begin(), pixels.end(), colour);
+    }
+
+    // colour and depth, depth back to the far plane
+    void clear(uint32_t colour) {
+        fill(colour);
+        std::fill(depth.begin(), depth.end(), static_cast<uint32_t>(DEPTH_MAX));
+    }
+
+    // Bresenham, pixels off the buffer are dropped (the 2D clipper lets x == width and y == height through)
+    void draw_line(int x1, int y1, int x2, int y2, uint32_t colour) {
+        const int dx = std::abs(x2 - x1);
+        const int dy = -std::abs(y2 - y1);
+        const int sx = x1 < x2 ? 1 : -1;
+        const int sy = y1 < y2 ? 1 : -1;
+        int err = dx + dy;
+        while (true) {
+            if (x1 >= 0 && x1 < width && y1 >= 0 && y1 < height) {
+                pixel(x1, y1) = colour;
+            }
+            if (x1 == x2 && y1 == y2) {
+                break;
+            }
+            const int e2 = 2 * err;
+            if (e2 >= dy) {
+                err += dy;
+                x1 += sx;
+            }
+            if (e2 <= dx) {
+                err += dx;
+                y1 += sy;
+            }
+        }
+    }
+
+    // binary PPM (P6), alpha is dropped
+    bool write_ppm(const std::string& path) const {
+        std::ofstream out (path, std::ios::binary);
+        if (!out) {
+            return false;
+        }
+        out << "P6\n" << width << ' ' << height << "\n255\n";
+        std::vector<char> row (static_cast<std::size_t>(width) * 3);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                const uint32_t p = pixel(x, y);
+                row[x*3] = static_cast<char>(p & 0xff);
+                row[x*3 + 1] = static_cast<char>((p >> 8) & 0xff);
+                row[x*3 + 2] = static_cast<char>((p >> 16) & 0xff);
+            }
+            out.write(row.data(), row.size());
+        }
+        return static_cast<bool>(out);
+    }
+
+private:
+    static int padded(int n, int multiple) {
+        return (n + multiple - 1) / multiple * multiple;
+    }
+};
@@ -0,0 +1,93 @@
+#pragma once
+#include <cmath>
+#include "Point.hpp"
+#include "Matrix.hpp"
+#include "Bounds.hpp"
+
+// the six planes of a view-projection matrix's frustum in world space (Gribb/Hartmann), using
+// the same conventions as ClipSpace.hpp: -w <= x,y <= w and 0 <= z <= w
+template <Numeric N>
+struct Frustum {
+    // a*x + b*y + c*z + d >= 0 inside, (a, b, c) normalized
+    struct Plane {
+        N a;
+        N b;
+        N c;
+        N d;
+
+        N distance(const Point<N>& p) const {
+            return a*p.x + b*p.y + c*p.z + d;
+        }
+    };
+
+    Plane planes[6];
+
+    explicit Frustum(const Mat4<N>& mat) {
+        // worked out in double whatever N is, the far plane is the difference of two nearly
+        // equal rows and its normal is too short to normalize in float or fixed point
+        double m[4][4];
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                m[i][j] = static_cast<double>(mat.m[i][j]);
+            }
+        }
+        const auto normalized = [](double a, double b, double c, double d) {
+            const double len = std::sqrt(a*a + b*b + c*c);
+            return Plane{static_cast<N>(a / len), static_cast<N>(b / len), static_cast<N>(c / len), static_cast<N>(d / len)};
+        };
+        const auto combine = [&](int row, double sign) {
+            return normalized(m[3][0] + sign*m[row][0], m[3][1] + sign*m[row][1], m[3][2] + sign*m[row][2], m[3][3] + sign*m[row][3]);
+        };
+
+        planes[0] = combine(0, 1);  // left
+        planes[1] = combine(0, -1); // right
+        planes[2] = combine(1, 1);  // bottom
+        planes[3] = combine(1, -1); // top
+        planes[4] = normalized(m[2][0], m[2][1], m[2][2], m[2][3]); // near
+        planes[5] = combine(2, -1); // far
+    }
+
+    bool intersects_sphere(const Point<N>& centre, N radius) const {
+        for (const Plane& p : planes) {
+            if (p.distance(centre) < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool intersects_aabb(const Point<N>& min, const Point<N>& max) const {
+        for (const Plane& p : planes) {
+            // the box corner furthest along the plane normal
+            const Point<N> v (
+                p.a >= 0 ? max.x : min.x,
+                p.b >= 0 ? max.y : min.y,
+                p.c >= 0 ? max.z : min.z
+            );
+            if (p.distance(v) < 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool contains_aabb(const Point<N>& min, const Point<N>& max) const {
+        for (const Plane& p : planes) {
+            // the box corner furthest against the plane normal
+            const Point<N> v (
+                p.a >= 0 ? min.x : max.x,
+                p.b >= 0 ? min.y : max.y,
+                p.c >= 0 ? min.z : max.z
+            );
+            if (p.distance(v) < 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // cheap sphere test first, box test for what's left
+    bool intersects(const Bounds<N>& b) const {
+        return intersects_sphere(b.centre, b.radius) && intersects_aabb(b.min, b.max);
+    }
+};
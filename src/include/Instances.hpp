@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "Point.hpp"
+#include "Transform.hpp"
+#include "Triangle.hpp"
+
+// many placements of one geometry. an instance is only a transform and a packed colour, so N
+// instances cost O(geometry + N) memory where N Meshes would each carry a matrix and bounds.
+template <Numeric N>
+struct InstanceSet {
+    GeometryPtr<N> geometry;
+    std::vector<Transform<N>> transforms;
+    std::vector<uint32_t> colours; // 0xRRGGBB
+
+    explicit InstanceSet(GeometryPtr<N> geometry) : geometry{std::move(geometry)} {}
+
+    std::size_t size() const {
+        return transforms.size();
+    }
+
+    std::size_t add(const Transform<N>& t, int red, int green, int blue) {
+        transforms.push_back(t);
+        colours.push_back(pack_colour(red, green, blue));
+        return transforms.size() - 1;
+    }
+
+    // world space bounds of instance i
+    Bounds<N> bounds(std::size_t i) const {
+        return transform_bounds(geometry->bounds, transforms[i].matrix(), transforms[i].scale);
+    }
+
+    static uint32_t pack_colour(int red, int green, int blue) {
+        return (static_cast<uint32_t>(red & 0xff) << 16) | (static_cast<uint32_t>(green & 0xff) << 8) | static_cast<uint32_t>(blue & 0xff);
+    }
+};
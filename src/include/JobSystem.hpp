@@ -0,0 +1,201 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+
+// persistent worker pool with one task queue per thread. owners pop from the back of their own
+// queue, idle threads steal from the front of the others. the thread calling parallel_for takes
+// part as thread 0, so a pool of thread_count() threads spawns thread_count()-1 workers.
+class JobSystem {
+public:
+    explicit JobSystem(unsigned threads = std::max(1u, std::thread::hardware_concurrency())) {
+        threads = std::max(1u, threads);
+        for (unsigned i = 0; i < threads; i++) {
+            queues.push_back(std::make_unique<Queue>());
+        }
+        for (unsigned i = 1; i < threads; i++) {
+            workers.emplace_back([this, i] { worker_loop(i); });
+        }
+    }
+
+    ~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock (sleep_lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : workers) {
+            t.join();
+        }
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned thread_count() const {
+        return static_cast<unsigned>(queues.size());
+    }
+
+    // run fn(begin, end, thread) over [0, count) in chunks of at most chunk items and block until
+    // every chunk is done. thread is in [0, thread_count()) and unique among concurrent calls of fn.
+    template <typename F>
+    void parallel_for(std::size_t count, std::size_t chunk, F&& fn) {
+        if (count == 0) {
+            return;
+        }
+        chunk = std::max<std::size_t>(1, chunk);
+
+        using Fn = std::remove_reference_t<F>;
+        Batch batch;
+        batch.fn = const_cast<void*>(static_cast<const void*>(&fn));
+        batch.invoke = [](void* f, std::size_t begin, std::size_t end, unsigned thread) {
+            (*static_cast<Fn*>(f))(begin, end, thread);
+        };
+
+        const std::size_t chunks = (count + chunk - 1) / chunk;
+        batch.remaining.store(chunks, std::memory_order_relaxed);
+
+        // counted before any chunk is queued, so a worker already looking for work can't pop one
+        // and take pending below zero
+        {
+            std::lock_guard<std::mutex> lock (sleep_lock);
+            pending.fetch_add(chunks, std::memory_order_release);
+        }
+
+        // deal chunks out round robin, stealing evens out whatever this gets wrong
+        for (std::size_t c = 0; c < chunks; c++) {
+            Queue& q = *queues[c % queues.size()];
+            std::lock_guard<std::mutex> lock (q.lock);
+            q.tasks.push_back(Task{&batch, c * chunk, std::min(count, (c + 1) * chunk)});
+        }
+        wake.notify_all();
+
+        // help out until the batch is finished
+        while (batch.remaining.load(std::memory_order_acquire) > 0) {
+            Task t;
+            if (try_pop(0, t)) {
+                execute(t, 0);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    struct Batch {
+        void (*invoke)(void*, std::size_t, std::size_t, unsigned) = nullptr;
+        void* fn = nullptr;
+        std::atomic<std::size_t> remaining {0};
+    };
+
+    struct Task {
+        Batch* batch = nullptr;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+    };
+
+    // double ended ring of tasks. unlike a deque it keeps its storage when it empties, so once a
+    // queue has held the most tasks a frame deals it, pushing and popping never allocate.
+    class TaskRing {
+    public:
+        bool empty() const {
+            return head == tail;
+        }
+
+        void push_back(const Task& t) {
+            if (tail - head == items.size()) {
+                grow();
+            }
+            items[tail++ & (items.size() - 1)] = t;
+        }
+
+        Task pop_back() {
+            return items[--tail & (items.size() - 1)];
+        }
+
+        Task pop_front() {
+            return items[head++ & (items.size() - 1)];
+        }
+
+    private:
+        std::vector<Task> items; // size is 0 or a power of two
+        std::size_t head = 0;
+        std::size_t tail = 0;
+
+        void grow() {
+            std::vector<Task> bigger (std::max<std::size_t>(64, items.size() * 2));
+            for (std::size_t i = head; i != tail; i++) {
+                bigger[i - head] = items[i & (items.size() - 1)];
+            }
+            tail -= head;
+            head = 0;
+            items.swap(bigger);
+        }
+    };
+
+    struct Queue {
+        std::mutex lock;
+        TaskRing tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    // tasks announced by parallel_for but not yet picked up, counted before they are queued so it
+    // never drops below zero. idle workers sleep while this is 0
+    std::atomic<std::size_t> pending {0};
+    std::mutex sleep_lock;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    bool try_pop(unsigned self, Task& out) {
+        // newest task from our own queue first
+        {
+            Queue& q = *queues[self];
+            std::lock_guard<std::mutex> lock (q.lock);
+            if (!q.tasks.empty()) {
+                out = q.tasks.pop_back();
+                pending.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        // then steal the oldest task from someone else
+        for (std::size_t i = 1; i < queues.size(); i++) {
+            Queue& q = *queues[(self + i) % queues.size()];
+            std::lock_guard<std::mutex> lock (q.lock);
+            if (!q.tasks.empty()) {
+                out = q.tasks.pop_front();
+                pending.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void execute(const Task& t, unsigned self) {
+        t.batch->invoke(t.batch->fn, t.begin, t.end, self);
+        t.batch->remaining.fetch_sub(1, std::memory_order_release);
+    }
+
+    void worker_loop(unsigned self) {
+        while (true) {
+            Task t;
+            if (try_pop(self, t)) {
+                execute(t, self);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock (sleep_lock);
+            wake.wait(lock, [this] { return stopping || pending.load(std::memory_order_acquire) > 0; });
+            if (stopping && pending.load(std::memory_order_acquire) == 0) {
+                return;
+            }
+        }
+    }
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include "Pipeline.hpp"
+
+// segments of one colour, endpoints packed as x1,y1,x2,y2,x1,y1,...
+struct LineGroup {
+    int red;
+    int green;
+    int blue;
+    std::vector<int> points;
+
+    std::size_t size() const {
+        return points.size() / 4;
+    }
+};
+
+// collects a frame's clipped segments grouped by colour so a backend can submit each colour
+// with a single draw call. groups (and their storage) persist across frames, clear() only
+// empties them.
+class LineBatch {
+public:
+    void clear() {
+        for (LineGroup& g : groups) {
+            g.points.clear();
+        }
+    }
+
+    void add(const LineSegment& l) {
+        std::vector<int>& points = group(l.red, l.green, l.blue).points;
+        points.push_back(l.x1);
+        points.push_back(l.y1);
+        points.push_back(l.x2);
+        points.push_back(l.y2);
+    }
+
+    void add(const std::vector<ThreadLines>& lines) {
+        for (const ThreadLines& t : lines) {
+            for (const LineSegment& l : t.segments) {
+                add(l);
+            }
+        }
+    }
+
+    // groups in first-seen order, may contain empty groups from earlier frames
+    const std::vector<LineGroup>& line_groups() const {
+        return groups;
+    }
+
+    std::size_t segment_count() const {
+        std::size_t n = 0;
+        for (const LineGroup& g : groups) {
+            n += g.size();
+        }
+        return n;
+    }
+
+private:
+    std::vector<LineGroup> groups;
+    std::unordered_map<uint32_t, std::size_t> index;
+
+    // last group used, consecutive segments usually share a mesh and so a colour
+    uint32_t last_key = UINT32_MAX;
+    std::size_t last_group = 0;
+
+    LineGroup& group(int red, int green, int blue) {
+        const uint32_t key = (static_cast<uint32_t>(red & 0xff) << 16) | (static_cast<uint32_t>(green & 0xff) << 8) | static_cast<uint32_t>(blue & 0xff);
+        if (key != last_key) {
+            const auto [it, inserted] = index.try_emplace(key, groups.size());
+            if (inserted) {
+                groups.push_back(LineGroup{red, green, blue, {}});
+            }
+            last_key = key;
+            last_group = it->second;
+        }
+        return groups[last_group];
+    }
+};
@@ -0,0 +1,290 @@
+#pragma once
+#include <cmath>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include "VertexArray.hpp"
+#include "Simd.hpp"
+#include "CohenSutherlandClip.hpp"
+
+// batch window clipping of 2d segments. outcodes of every segment are computed four at a time,
+// which settles most segments straight away (entirely inside, or entirely beyond one edge), and
+// only the rest go through a Liang-Barsky parametric clip. survivors are written out compacted
+// and in their original order.
+
+// the rectangle segments are clipped to, every edge inclusive like cohen_sutherland_clip
+struct ClipRect {
+    int x_min;
+    int y_min;
+    int x_max;
+    int y_max;
+};
+
+// segments as structure of arrays, colour is 0xRRGGBB
+struct SegmentArray {
+    AlignedVector<int32_t> x1;
+    AlignedVector<int32_t> y1;
+    AlignedVector<int32_t> x2;
+    AlignedVector<int32_t> y2;
+    AlignedVector<uint32_t> colour;
+
+    std::size_t size() const {
+        return x1.size();
+    }
+
+    void clear() {
+        x1.clear();
+        y1.clear();
+        x2.clear();
+        y2.clear();
+        colour.clear();
+    }
+
+    void resize(std::size_t n) {
+        x1.resize(n);
+        y1.resize(n);
+        x2.resize(n);
+        y2.resize(n);
+        colour.resize(n);
+    }
+
+    void set(std::size_t i, int32_t ax, int32_t ay, int32_t bx, int32_t by, uint32_t c) {
+        x1[i] = ax;
+        y1[i] = ay;
+        x2[i] = bx;
+        y2[i] = by;
+        colour[i] = c;
+    }
+
+    void push_back(int32_t ax, int32_t ay, int32_t bx, int32_t by, uint32_t c) {
+        x1.push_back(ax);
+        y1.push_back(ay);
+        x2.push_back(bx);
+        y2.push_back(by);
+        colour.push_back(c);
+    }
+};
+
+// what clip_segments did with its input
+struct SegmentClipStats {
+    std::size_t accepted = 0; // entirely inside, passed through untouched
+    std::size_t clipped = 0; // crossing the rectangle and cut down to the part inside
+    std::size_t rejected = 0; // nothing inside
+
+    SegmentClipStats& operator+=(const SegmentClipStats& rhs) {
+        accepted += rhs.accepted;
+        clipped += rhs.clipped;
+        rejected += rhs.rejected;
+        return *this;
+    }
+};
+
+namespace scalar {
+
+// same bits as compute_outcode
+inline int32_t segment_outcode(int32_t x, int32_t y, const ClipRect& r) {
+    return (x < r.x_min ? LEFT : 0) | (x > r.x_max ? RIGHT : 0) | (y < r.y_min ? BOTTOM : 0) | (y > r.y_max ? TOP : 0);
+}
+
+// Liang-Barsky, the part of the segment inside r or false if there's none. c1 and c2 are the
+// outcodes of its ends: an edge only the first end is beyond is where the segment enters r, one
+// only the second end is beyond is where it leaves. done in float like the sse2 kernel, exact for
+// the ints involved, and the new ends rounded to the nearest pixel inside r.
+inline bool liang_barsky(int32_t& x1, int32_t& y1, int32_t& x2, int32_t& y2, int32_t c1, int32_t c2, const ClipRect& r) {
+    const float fx1 = static_cast<float>(x1);
+    const float fy1 = static_cast<float>(y1);
+    const float dx = static_cast<float>(x2) - fx1;
+    const float dy = static_cast<float>(y2) - fy1;
+
+    // where the line meets each edge, only read for edges one end is beyond so never 0/0
+    const int32_t bits[4] = {LEFT, RIGHT, BOTTOM, TOP};
+    const float t[4] = {
+        (static_cast<float>(r.x_min) - fx1) / dx,
+        (static_cast<float>(r.x_max) - fx1) / dx,
+        (static_cast<float>(r.y_min) - fy1) / dy,
+        (static_cast<float>(r.y_max) - fy1) / dy,
+    };
+    float t0 = 0.0f;
+    float t1 = 1.0f;
+    for (int i = 0; i < 4; i++) {
+        if (c1 & bits[i]) {
+            t0 = std::max(t0, t[i]);
+        }
+        if (c2 & bits[i]) {
+            t1 = std::min(t1, t[i]);
+        }
+    }
+    if (t0 > t1) {
+        return false;
+    }
+
+    // clamped first, then rounding is truncation of a positive offset from the edge
+    const auto round_into = [](float v, int32_t lo, int32_t hi) {
+        return lo + static_cast<int32_t>(std::clamp(v - static_cast<float>(lo), 0.0f, static_cast<float>(hi - lo)) + 0.5f);
+    };
+    const int32_t ax = round_into(fx1 + t0 * dx, r.x_min, r.x_max);
+    const int32_t ay = round_into(fy1 + t0 * dy, r.y_min, r.y_max);
+    const int32_t bx = round_into(fx1 + t1 * dx, r.x_min, r.x_max);
+    const int32_t by = round_into(fy1 + t1 * dy, r.y_min, r.y_max);
+    x1 = ax;
+    y1 = ay;
+    x2 = bx;
+    y2 = by;
+    return true;
+}
+
+// segment i of in, whose ends have outcodes c1 and c2, written to out at o if any of it is inside r
+inline void clip_one(const SegmentArray& in, std::size_t i, int32_t c1, int32_t c2, const ClipRect& r, SegmentArray& out, std::size_t& o, SegmentClipStats& stats) {
+    if ((c1 | c2) == 0) {
+        out.set(o++, in.x1[i], in.y1[i], in.x2[i], in.y2[i], in.colour[i]);
+        stats.accepted += 1;
+        return;
+    }
+    if (c1 & c2) {
+        stats.rejected += 1;
+        return;
+    }
+    int32_t x1 = in.x1[i], y1 = in.y1[i], x2 = in.x2[i], y2 = in.y2[i];
+    if (liang_barsky(x1, y1, x2, y2, c1, c2, r)) {
+        out.set(o++, x1, y1, x2, y2, in.colour[i]);
+        stats.clipped += 1;
+    } else {
+        stats.rejected += 1;
+    }
+}
+
+inline SegmentClipStats clip_segments(const SegmentArray& in, const ClipRect& r, SegmentArray& out) {
+    SegmentClipStats stats;
+    std::size_t o = out.size();
+    out.resize(o + in.size());
+    for (std::size_t i = 0; i < in.size(); i++) {
+        clip_one(in, i, segment_outcode(in.x1[i], in.y1[i], r), segment_outcode(in.x2[i], in.y2[i], r), r, out, o, stats);
+    }
+    out.resize(o);
+    return stats;
+}
+
+} // namespace scalar
+
+#if ENGINE_SIMD_X86
+namespace sse2 {
+
+__attribute__((target("sse2")))
+inline __m128i segment_outcodes(__m128i x, __m128i y, const ClipRect& r) {
+    const __m128i left = _mm_and_si128(_mm_cmplt_epi32(x, _mm_set1_epi32(r.x_min)), _mm_set1_epi32(LEFT));
+    const __m128i right = _mm_and_si128(_mm_cmpgt_epi32(x, _mm_set1_epi32(r.x_max)), _mm_set1_epi32(RIGHT));
+    const __m128i bottom = _mm_and_si128(_mm_cmplt_epi32(y, _mm_set1_epi32(r.y_min)), _mm_set1_epi32(BOTTOM));
+    const __m128i top = _mm_and_si128(_mm_cmpgt_epi32(y, _mm_set1_epi32(r.y_max)), _mm_set1_epi32(TOP));
+    return _mm_or_si128(_mm_or_si128(left, right), _mm_or_si128(bottom, top));
+}
+
+// liang_barsky on four segments at once, lanes with nothing inside r come back false in visible
+__attribute__((target("sse2")))
+inline void liang_barsky(__m128i& x1, __m128i& y1, __m128i& x2, __m128i& y2, __m128i c1, __m128i c2, const ClipRect& r, __m128& visible) {
+    const __m128 fx1 = _mm_cvtepi32_ps(x1);
+    const __m128 fy1 = _mm_cvtepi32_ps(y1);
+    const __m128 dx = _mm_sub_ps(_mm_cvtepi32_ps(x2), fx1);
+    const __m128 dy = _mm_sub_ps(_mm_cvtepi32_ps(y2), fy1);
+
+    __m128 t0 = _mm_setzero_ps();
+    __m128 t1 = _mm_set1_ps(1.0f);
+    const auto edge = [&](int32_t bit, __m128 t) {
+        const __m128i b = _mm_set1_epi32(bit);
+        const __m128 enters = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(c1, b), b));
+        const __m128 leaves = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(c2, b), b));
+        t0 = _mm_or_ps(_mm_and_ps(enters, _mm_max_ps(t0, t)), _mm_andnot_ps(enters, t0));
+        t1 = _mm_or_ps(_mm_and_ps(leaves, _mm_min_ps(t1, t)), _mm_andnot_ps(leaves, t1));
+    };
+    edge(LEFT, _mm_div_ps(_mm_sub_ps(_mm_set1_ps(static_cast<float>(r.x_min)), fx1), dx));
+    edge(RIGHT, _mm_div_ps(_mm_sub_ps(_mm_set1_ps(static_cast<float>(r.x_max)), fx1), dx));
+    edge(BOTTOM, _mm_div_ps(_mm_sub_ps(_mm_set1_ps(static_cast<float>(r.y_min)), fy1), dy));
+    edge(TOP, _mm_div_ps(_mm_sub_ps(_mm_set1_ps(static_cast<float>(r.y_max)), fy1), dy));
+    visible = _mm_cmple_ps(t0, t1);
+
+    const auto round_into = [](__m128 v, int32_t lo, int32_t hi) {
+        const __m128 offset = _mm_min_ps(_mm_max_ps(_mm_sub_ps(v, _mm_set1_ps(static_cast<float>(lo))), _mm_setzero_ps()), _mm_set1_ps(static_cast<float>(hi - lo)));
+        return _mm_add_epi32(_mm_set1_epi32(lo), _mm_cvttps_epi32(_mm_add_ps(offset, _mm_set1_ps(0.5f))));
+    };
+    x1 = round_into(_mm_add_ps(fx1, _mm_mul_ps(t0, dx)), r.x_min, r.x_max);
+    y1 = round_into(_mm_add_ps(fy1, _mm_mul_ps(t0, dy)), r.y_min, r.y_max);
+    x2 = round_into(_mm_add_ps(fx1, _mm_mul_ps(t1, dx)), r.x_min, r.x_max);
+    y2 = round_into(_mm_add_ps(fy1, _mm_mul_ps(t1, dy)), r.y_min, r.y_max);
+}
+
+__attribute__((target("sse2")))
+inline SegmentClipStats clip_segments(const SegmentArray& in, const ClipRect& r, SegmentArray& out) {
+    SegmentClipStats stats;
+    const std::size_t n = in.size();
+    std::size_t o = out.size();
+    out.resize(o + n);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&in.x1[i]));
+        __m128i y1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&in.y1[i]));
+        __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&in.x2[i]));
+        __m128i y2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&in.y2[i]));
+        const __m128i colour = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&in.colour[i]));
+        const __m128i c1 = segment_outcodes(x1, y1, r);
+        const __m128i c2 = segment_outcodes(x2, y2, r);
+        const __m128i zero = _mm_setzero_si128();
+        const int inside = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_or_si128(c1, c2), zero)));
+        const int outside = ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(c1, c2), zero))) & 0xf;
+
+        // the common cases settled for all four at once
+        if (inside == 0xf) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&out.x1[o]), x1);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&out.y1[o]), y1);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&out.x2[o]), x2);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&out.y2[o]), y2);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&out.colour[o]), colour);
+            o += 4;
+            stats.accepted += 4;
+            continue;
+        }
+        if (outside == 0xf) {
+            stats.rejected += 4;
+            continue;
+        }
+
+        // the rest clipped together, lanes already inside come through unchanged (t0 = 0,
+        // t1 = 1 and float is exact on the ints), then written out compacted
+        __m128 visible;
+        liang_barsky(x1, y1, x2, y2, c1, c2, r, visible);
+        const int keep = _mm_movemask_ps(visible) & ~outside;
+
+        alignas(16) int32_t lanes[5][4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes[0]), x1);
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes[1]), y1);
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes[2]), x2);
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes[3]), y2);
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes[4]), colour);
+        for (int k = 0; k < 4; k++) {
+            out.set(o, lanes[0][k], lanes[1][k], lanes[2][k], lanes[3][k], static_cast<uint32_t>(lanes[4][k]));
+            o += (keep >> k) & 1;
+        }
+        const int accepted = std::popcount(static_cast<unsigned>(inside));
+        const int kept = std::popcount(static_cast<unsigned>(keep));
+        stats.accepted += accepted;
+        stats.clipped += kept - accepted;
+        stats.rejected += 4 - kept;
+    }
+    for (; i < n; i++) {
+        scalar::clip_one(in, i, scalar::segment_outcode(in.x1[i], in.y1[i], r), scalar::segment_outcode(in.x2[i], in.y2[i], r), r, out, o, stats);
+    }
+    out.resize(o);
+    return stats;
+}
+
+} // namespace sse2
+#endif
+
+// the parts of in's segments inside r, appended to out
+inline SegmentClipStats clip_segments(const SegmentArray& in, const ClipRect& r, SegmentArray& out) {
+#if ENGINE_SIMD_X86
+    if (detect_simd_level() != SimdLevel::SCALAR) {
+        return sse2::clip_segments(in, r, out);
+    }
+#endif
+    return scalar::clip_segments(in, r, out);
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include "Point.hpp"
+#include "Matrix.hpp"
+#include "Camera.hpp"
+#include "Triangle.hpp"
+#include "Simplify.hpp"
+
+// each level aims for half the faces of the one before, down to LOD_MIN_FACES
+constexpr std::size_t LOD_MIN_FACES = 16;
+constexpr std::size_t LOD_MAX_LEVELS = 8;
+
+// a level may be drawn once its error covers no more than this many pixels, before the bias
+constexpr double LOD_PIXEL_ERROR = 1.0;
+
+// g with its chain of simplified levels. meant for load time, a level costs a pass of edge
+// collapses over the whole model.
+template <Numeric N>
+GeometryPtr<N> build_lods(Geometry<N> g) {
+    if (g.faces.size() >= 2 * LOD_MIN_FACES) {
+        QuadricSimplifier<N> simplifier (g);
+        std::size_t previous = g.faces.size();
+        while (g.lods.size() < LOD_MAX_LEVELS && previous / 2 >= LOD_MIN_FACES) {
+            simplifier.collapse_to(previous / 2);
+            // stuck well short of the target, nothing more can go without breaking the surface
+            if (simplifier.face_count() > previous * 3 / 4) {
+                break;
+            }
+            g.lods.push_back({std::make_shared<const Geometry<N>>(simplifier.geometry()), static_cast<N>(simplifier.error())});
+            previous = simplifier.face_count();
+        }
+    }
+    return std::make_shared<const Geometry<N>>(std::move(g));
+}
+
+// screen pixels covered by one unit of length one unit in front of the eye
+template <Numeric N>
+double lod_pixel_scale(const Mat4<N>& view_proj, const Viewport& vp) {
+    const auto row_length = [&](int row) {
+        const double x = static_cast<double>(view_proj.m[row][0]), y = static_cast<double>(view_proj.m[row][1]), z = static_cast<double>(view_proj.m[row][2]);
+        return std::sqrt(x*x + y*y + z*z);
+    };
+    return std::max(vp.width / 2.0 * row_length(0), vp.height / 2.0 * row_length(1));
+}
+
+// the coarsest level of g placed by model whose error stays within max_pixels on screen. the
+// distance is taken to the near side of the bounding sphere so the error is never understated.
+template <Numeric N>
+const Geometry<N>& select_lod(const Geometry<N>& g, const Mat4<N>& model, const Mat4<N>& view_proj, double pixel_scale, double max_pixels) {
+    if (g.lods.empty()) {
+        return g;
+    }
+
+    // uniform scale, the length of any column of the rotation part
+    const double scale = std::sqrt(static_cast<double>(model.m[0][0]*model.m[0][0] + model.m[1][0]*model.m[1][0] + model.m[2][0]*model.m[2][0]));
+    const Vec4<N> centre = model.transform(g.bounds.centre);
+    const double w = static_cast<double>(view_proj.m[3][0]*centre.x + view_proj.m[3][1]*centre.y + view_proj.m[3][2]*centre.z + view_proj.m[3][3]);
+    const double distance = w - static_cast<double>(g.bounds.radius) * scale;
+    if (distance <= 0) {
+        return g;
+    }
+
+    const double pixels_per_unit = pixel_scale * scale / distance;
+    const Geometry<N>* pick = &g;
+    for (const typename Geometry<N>::Lod& lod : g.lods) {
+        if (static_cast<double>(lod.error) * pixels_per_unit > max_pixels) {
+            break;
+        }
+        pick = lod.geometry.get();
+    }
+    return *pick;
+}
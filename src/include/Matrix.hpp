@@ -0,0 +1,80 @@
+#pragma once
+#include <cmath>
+#include "Point.hpp"
+
+// homogeneous clip space coordinate
+template <Numeric N>
+struct Vec4 {
+    N x;
+    N y;
+    N z;
+    N w;
+
+    Vec4() : x{0}, y{0}, z{0}, w{0} {}
+    Vec4(N x, N y, N z, N w) : x{x}, y{y}, z{z}, w{w} {}
+};
+
+// row-major 4x4 matrix, points are treated as column vectors (M * p)
+template <Numeric N>
+struct Mat4 {
+    N m[4][4] = {};
+
+    static Mat4 identity() {
+        Mat4 r;
+        r.m[0][0] = 1;
+        r.m[1][1] = 1;
+        r.m[2][2] = 1;
+        r.m[3][3] = 1;
+        return r;
+    }
+
+    bool operator==(const Mat4&) const = default;
+
+    Mat4 operator*(const Mat4& rhs) const {
+        Mat4 r;
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                r.m[i][j] = m[i][0]*rhs.m[0][j] + m[i][1]*rhs.m[1][j] + m[i][2]*rhs.m[2][j] + m[i][3]*rhs.m[3][j];
+            }
+        }
+        return r;
+    }
+
+    // transform a point with an implicit w of 1
+    Vec4<N> transform(const Point<N>& p) const {
+        return Vec4<N>(
+            m[0][0]*p.x + m[0][1]*p.y + m[0][2]*p.z + m[0][3],
+            m[1][0]*p.x + m[1][1]*p.y + m[1][2]*p.z + m[1][3],
+            m[2][0]*p.x + m[2][1]*p.y + m[2][2]*p.z + m[2][3],
+            m[3][0]*p.x + m[3][1]*p.y + m[3][2]*p.z + m[3][3]
+        );
+    }
+};
+
+template <Numeric N>
+Mat4<N> make_translation_matrix(const Point<N>& t) {
+    Mat4<N> r = Mat4<N>::identity();
+    r.m[0][3] = t.x;
+    r.m[1][3] = t.y;
+    r.m[2][3] = t.z;
+    return r;
+}
+
+// pitch turns the zy plane around the x axis, then yaw turns the xz plane around the y axis
+template <Numeric N>
+Mat4<N> make_rotation_matrix(double pitch, double yaw) {
+    const N cp = static_cast<N>(cos(pitch));
+    const N sp = static_cast<N>(sin(pitch));
+    const N cy = static_cast<N>(cos(yaw));
+    const N sy = static_cast<N>(sin(yaw));
+
+    Mat4<N> p = Mat4<N>::identity();
+    p.m[1][1] = cp; p.m[1][2] = sp;
+    p.m[2][1] = -sp; p.m[2][2] = cp;
+
+    Mat4<N> y = Mat4<N>::identity();
+    y.m[0][0] = cy; y.m[0][2] = -sy;
+    y.m[2][0] = sy; y.m[2][2] = cy;
+
+    return y * p;
+}
@@ -0,0 +1,355 @@
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <optional>
+#include <filesystem>
+#include <system_error>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Triangle.hpp"
+#include "VertexArray.hpp"
+
+// a model file as parsed, before its edges, normals and levels of detail are derived
+struct ModelData {
+    VertexArray<double> verts;
+    std::vector<Face> faces;
+};
+
+// binary cache of a loaded model, written next to the source as <source>.meshcache. it holds the
+// model's Geometry<double> and every level of detail build_lods made from it, each with its
+// edges, edge faces and normals, so a warm load is bulk copies out of a memory mapping instead of
+// a text parse, an edge sort and a chain of simplifier passes. the vertex arrays are stored
+// exactly as VertexArray lays them out (SoA, 32 byte aligned and padded).
+//
+// layout: MeshCacheHeader, then level_count MeshCacheLevels, then for each level x, y and z
+// (vertex_padded doubles each), face_count normals (three doubles each), face_count Faces,
+// edge_count Edges and edge_count pairs of bordering faces, each array starting on a 32 byte
+// boundary. level 0 is the model itself, the rest its levels of detail, finest first.
+
+constexpr char MESH_CACHE_MAGIC[8] = {'M', 'E', 'S', 'H', 'C', 'A', 'C', 'H'};
+constexpr uint32_t MESH_CACHE_VERSION = 2;
+
+struct MeshCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+
+    // the source file this was built from, a mismatch means the cache is stale
+    uint64_t source_size;
+    int64_t source_mtime;
+
+    uint64_t level_count;
+
+    // byte offsets from the start of the file
+    uint64_t levels_offset;
+    uint64_t file_size;
+
+    uint8_t reserved[8];
+};
+static_assert(sizeof(MeshCacheHeader) % SIMD_ALIGN == 0);
+
+struct MeshCacheLevel {
+    uint64_t vertex_count;
+    uint64_t vertex_padded;
+    uint64_t face_count;
+    uint64_t edge_count;
+
+    // Geometry::Lod::error, 0 for level 0
+    double error;
+
+    // byte offsets from the start of the file
+    uint64_t x_offset;
+    uint64_t y_offset;
+    uint64_t z_offset;
+    uint64_t normals_offset;
+    uint64_t faces_offset;
+    uint64_t edges_offset;
+    uint64_t edge_faces_offset;
+};
+static_assert(sizeof(MeshCacheLevel) % SIMD_ALIGN == 0);
+
+inline std::filesystem::path mesh_cache_path(const std::filesystem::path& source) {
+    return std::filesystem::path(source.string() + ".meshcache");
+}
+
+// read only memory mapping of a whole file
+class MappedFile {
+public:
+    explicit MappedFile(const std::filesystem::path& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                bytes = static_cast<const uint8_t*>(p);
+                length = static_cast<std::size_t>(st.st_size);
+            }
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile() {
+        if (bytes) {
+            ::munmap(const_cast<uint8_t*>(bytes), length);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const {
+        return bytes;
+    }
+
+    std::size_t size() const {
+        return length;
+    }
+
+private:
+    const uint8_t* bytes = nullptr;
+    std::size_t length = 0;
+};
+
+// size and modification time of source, what the cache is keyed on
+inline bool source_stamp(const std::filesystem::path& source, uint64_t& size, int64_t& mtime) {
+    std::error_code ec;
+    size = std::filesystem::file_size(source, ec);
+    if (ec) {
+        return false;
+    }
+    mtime = std::filesystem::last_write_time(source, ec).time_since_epoch().count();
+    return !ec;
+}
+
+// the cached geometry for source with its levels of detail, or nullptr if there's no cache or
+// it's stale or damaged. the arrays are copied out of the mapping rather than used in place:
+// Geometry owns its AlignedVector storage everywhere it's used (pipeline, simplifier, scene),
+// float and fixed builds convert every array anyway, and the copies and checks take 2-3 ms for
+// the 8.7 MB cache of a 59.5k face model against the ~170 ms the cache saves.
+inline GeometryPtr<double> read_mesh_cache(const std::filesystem::path& source) {
+    uint64_t size;
+    int64_t mtime;
+    if (!source_stamp(source, size, mtime)) {
+        return nullptr;
+    }
+
+    const MappedFile file (mesh_cache_path(source));
+    if (!file.data() || file.size() < sizeof(MeshCacheHeader)) {
+        return nullptr;
+    }
+
+    MeshCacheHeader h;
+    std::memcpy(&h, file.data(), sizeof(h));
+
+    // every field comes from the file, so nothing is added or multiplied before it's known not to
+    // wrap: counts are capped by what the file could hold and ranges checked by subtraction
+    const uint64_t length = file.size();
+    const auto fits = [&](uint64_t offset, uint64_t bytes, std::size_t align) {
+        return offset % align == 0 && offset <= length && bytes <= length - offset;
+    };
+    const bool valid = std::memcmp(h.magic, MESH_CACHE_MAGIC, sizeof(h.magic)) == 0
+        && h.version == MESH_CACHE_VERSION
+        && h.header_size == sizeof(MeshCacheHeader)
+        && h.source_size == size
+        && h.source_mtime == mtime
+        && h.file_size == length
+        && h.level_count >= 1
+        && h.level_count <= length / sizeof(MeshCacheLevel)
+        && fits(h.levels_offset, h.level_count * sizeof(MeshCacheLevel), alignof(MeshCacheLevel));
+    if (!valid) {
+        return nullptr;
+    }
+
+    // one level's geometry, its indices checked so the pipeline can trust them
+    const auto read_level = [&](const MeshCacheLevel& l) -> std::optional<Geometry<double>> {
+        const bool valid = l.vertex_count <= length / sizeof(double)
+            && l.vertex_padded <= length / sizeof(double)
+            && l.face_count <= length / sizeof(Face)
+            && l.edge_count <= length / sizeof(Edge)
+            && l.vertex_padded == simd_padded<double>(l.vertex_count)
+            && fits(l.x_offset, l.vertex_padded * sizeof(double), alignof(double))
+            && fits(l.y_offset, l.vertex_padded * sizeof(double), alignof(double))
+            && fits(l.z_offset, l.vertex_padded * sizeof(double), alignof(double))
+            && fits(l.normals_offset, l.face_count * 3 * sizeof(double), alignof(double))
+            && fits(l.faces_offset, l.face_count * sizeof(Face), alignof(Face))
+            && fits(l.edges_offset, l.edge_count * sizeof(Edge), alignof(Edge))
+            && fits(l.edge_faces_offset, l.edge_count * 2 * sizeof(uint32_t), alignof(uint32_t));
+        if (!valid) {
+            return std::nullopt;
+        }
+        const uint64_t array_bytes = l.vertex_padded * sizeof(double);
+
+        VertexArray<double> verts;
+        verts.resize(l.vertex_count);
+        std::memcpy(verts.x.data(), file.data() + l.x_offset, array_bytes);
+        std::memcpy(verts.y.data(), file.data() + l.y_offset, array_bytes);
+        std::memcpy(verts.z.data(), file.data() + l.z_offset, array_bytes);
+
+        const Face* face_data = reinterpret_cast<const Face*>(file.data() + l.faces_offset);
+        std::vector<Face> faces (face_data, face_data + l.face_count);
+        for (const Face& f : faces) {
+            if (f.a >= l.vertex_count || f.b >= l.vertex_count || f.c >= l.vertex_count) {
+                return std::nullopt;
+            }
+        }
+
+        const Edge* edge_data = reinterpret_cast<const Edge*>(file.data() + l.edges_offset);
+        std::vector<Edge> edges (edge_data, edge_data + l.edge_count);
+        for (const Edge& e : edges) {
+            if (e.a >= l.vertex_count || e.b >= l.vertex_count) {
+                return std::nullopt;
+            }
+        }
+
+        const uint32_t* edge_face_data = reinterpret_cast<const uint32_t*>(file.data() + l.edge_faces_offset);
+        std::vector<std::pair<uint32_t, uint32_t>> edge_faces;
+        edge_faces.reserve(l.edge_count);
+        for (uint64_t i = 0; i < l.edge_count; i++) {
+            const uint32_t first = edge_face_data[2*i];
+            const uint32_t second = edge_face_data[2*i + 1];
+            if (first >= l.face_count || (second >= l.face_count && second != Geometry<double>::NO_FACE)) {
+                return std::nullopt;
+            }
+            edge_faces.emplace_back(first, second);
+        }
+
+        const double* normal_data = reinterpret_cast<const double*>(file.data() + l.normals_offset);
+        std::vector<Point<double>> normals;
+        normals.reserve(l.face_count);
+        for (uint64_t i = 0; i < l.face_count; i++) {
+            normals.push_back(Point<double>(normal_data[3*i], normal_data[3*i + 1], normal_data[3*i + 2]));
+        }
+
+        return Geometry<double>(std::move(verts), std::move(faces), std::move(edges), std::move(edge_faces), std::move(normals));
+    };
+
+    const MeshCacheLevel* levels = reinterpret_cast<const MeshCacheLevel*>(file.data() + h.levels_offset);
+    std::optional<Geometry<double>> model = read_level(levels[0]);
+    if (!model) {
+        return nullptr;
+    }
+    for (uint64_t i = 1; i < h.level_count; i++) {
+        std::optional<Geometry<double>> level = read_level(levels[i]);
+        if (!level) {
+            return nullptr;
+        }
+        model->lods.push_back({std::make_shared<const Geometry<double>>(std::move(level.value())), levels[i].error});
+    }
+    return std::make_shared<const Geometry<double>>(std::move(model.value()));
+}
+
+// write g and its levels of detail as source's cache. written to a temporary file and renamed
+// into place so a concurrent reader never sees half a cache.
+inline bool write_mesh_cache(const std::filesystem::path& source, const Geometry<double>& g) {
+    MeshCacheHeader h {};
+    std::memcpy(h.magic, MESH_CACHE_MAGIC, sizeof(h.magic));
+    h.version = MESH_CACHE_VERSION;
+    h.header_size = sizeof(MeshCacheHeader);
+    if (!source_stamp(source, h.source_size, h.source_mtime)) {
+        return false;
+    }
+
+    std::vector<const Geometry<double>*> geometries {&g};
+    std::vector<MeshCacheLevel> levels (1);
+    for (const Geometry<double>::Lod& lod : g.lods) {
+        geometries.push_back(lod.geometry.get());
+        levels.push_back(MeshCacheLevel{});
+        levels.back().error = lod.error;
+    }
+    h.level_count = levels.size();
+    h.levels_offset = sizeof(MeshCacheHeader);
+
+    // each array starts on the next 32 byte boundary after the one before
+    uint64_t end = h.levels_offset + levels.size() * sizeof(MeshCacheLevel);
+    const auto place = [&](uint64_t bytes) {
+        const uint64_t offset = (end + SIMD_ALIGN - 1) / SIMD_ALIGN * SIMD_ALIGN;
+        end = offset + bytes;
+        return offset;
+    };
+    for (std::size_t i = 0; i < levels.size(); i++) {
+        const Geometry<double>& level = *geometries[i];
+        MeshCacheLevel& l = levels[i];
+        l.vertex_count = level.verts.size();
+        l.vertex_padded = level.verts.padded_size();
+        l.face_count = level.faces.size();
+        l.edge_count = level.edges.size();
+
+        const uint64_t array_bytes = l.vertex_padded * sizeof(double);
+        l.x_offset = place(array_bytes);
+        l.y_offset = place(array_bytes);
+        l.z_offset = place(array_bytes);
+        l.normals_offset = place(l.face_count * 3 * sizeof(double));
+        l.faces_offset = place(l.face_count * sizeof(Face));
+        l.edges_offset = place(l.edge_count * sizeof(Edge));
+        l.edge_faces_offset = place(l.edge_count * 2 * sizeof(uint32_t));
+    }
+    h.file_size = end;
+
+    const std::filesystem::path path = mesh_cache_path(source);
+    const std::filesystem::path tmp = std::filesystem::path(path.string() + ".tmp");
+    {
+        std::ofstream out (tmp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+
+        // zero padding up to offset, then bytes
+        uint64_t written = 0;
+        const auto write_at = [&](uint64_t offset, const void* data, uint64_t bytes) {
+            static constexpr char zeros[SIMD_ALIGN] {};
+            out.write(zeros, offset - written);
+            out.write(static_cast<const char*>(data), bytes);
+            written = offset + bytes;
+        };
+        write_at(0, &h, sizeof(h));
+        write_at(h.levels_offset, levels.data(), levels.size() * sizeof(MeshCacheLevel));
+
+        std::vector<double> normals;
+        std::vector<uint32_t> edge_faces;
+        for (std::size_t i = 0; i < levels.size(); i++) {
+            const Geometry<double>& level = *geometries[i];
+            const MeshCacheLevel& l = levels[i];
+            const uint64_t array_bytes = l.vertex_padded * sizeof(double);
+            write_at(l.x_offset, level.verts.x.data(), array_bytes);
+            write_at(l.y_offset, level.verts.y.data(), array_bytes);
+            write_at(l.z_offset, level.verts.z.data(), array_bytes);
+
+            normals.clear();
+            for (const Point<double>& n : level.normals) {
+                normals.insert(normals.end(), {n.x, n.y, n.z});
+            }
+            write_at(l.normals_offset, normals.data(), normals.size() * sizeof(double));
+            write_at(l.faces_offset, level.faces.data(), l.face_count * sizeof(Face));
+            write_at(l.edges_offset, level.edges.data(), l.edge_count * sizeof(Edge));
+
+            edge_faces.clear();
+            for (const auto& [first, second] : level.edge_faces) {
+                edge_faces.insert(edge_faces.end(), {first, second});
+            }
+            write_at(l.edge_faces_offset, edge_faces.data(), edge_faces.size() * sizeof(uint32_t));
+        }
+        if (!out) {
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,487 @@
+#pragma once
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include "Triangle.hpp"
+#include "Camera.hpp"
+#include "VertexArray.hpp"
+#include "Simd.hpp"
+#include "JobSystem.hpp"
+#include "ClipSpace.hpp"
+#include "Frustum.hpp"
+#include "Scene.hpp"
+#include "Instances.hpp"
+#include "Lod.hpp"
+#include "Profiler.hpp"
+#include "LineClip.hpp"
+#include "FrameArena.hpp"
+
+// a clipped window space line and the colour of the mesh it came from
+struct LineSegment {
+    int x1;
+    int y1;
+    int x2;
+    int y2;
+    int red;
+    int green;
+    int blue;
+};
+
+// a window space triangle, v holds pixel positions and fixed point depth
+struct ScreenTriangle {
+    Point<int> v[3];
+    int red;
+    int green;
+    int blue;
+};
+
+// wireframe draws each shared edge once as a line, hidden line only the edges of faces turned
+// towards the camera, solid fills the front facing triangles with a depth test
+enum class RenderMode {
+    WIREFRAME,
+    HIDDEN_LINE,
+    SOLID
+};
+
+// per frame counters of what the pipeline skipped and what it drew
+struct FrameStats {
+    std::size_t meshes_drawn = 0;
+    std::size_t meshes_culled = 0;
+    std::size_t triangles_drawn = 0;
+    std::size_t triangles_culled = 0;
+    std::size_t triangles_backfacing = 0; // of triangles_drawn, not counted in WIREFRAME
+    std::size_t triangles_simplified = 0; // left out of triangles_drawn by picking coarser LODs
+    std::size_t vertices_transformed = 0;
+    std::size_t lines_culled = 0; // edges rejected whole by their outcodes, not counted in SOLID
+    std::size_t lines_clipped = 0; // edges cut short by the near/far planes or the window
+};
+
+// output of one thread, padded so neighbouring threads don't share a cache line
+struct alignas(64) ThreadLines {
+    std::vector<LineSegment> segments;
+    std::size_t culled = 0;
+    std::size_t clipped = 0;
+
+    // window clipping batches, kept between frames so they stop allocating
+    SegmentArray candidates; // only the window can cut these
+    SegmentArray cut; // already cut by the near/far planes
+    SegmentArray survivors;
+};
+
+struct alignas(64) ThreadTriangles {
+    std::vector<ScreenTriangle> triangles;
+};
+
+// one mesh or instance to draw, everything the pipeline needs from either
+template <Numeric N>
+struct DrawItem {
+    const Geometry<N>* geometry;
+    Mat4<N> model;
+    int red;
+    int green;
+    int blue;
+};
+
+// turns meshes into clipped window space line segments (or triangles in SOLID mode) across a
+// JobSystem. vertices are transformed one mesh per task, then the edges of all meshes are clipped
+// in fixed size chunks: rejected against the frustum and clipped to the near/far planes in clip
+// space, then clipped to the window after the divide a whole chunk at a time by clip_segments.
+// triangles are clipped the same way in clip space and left for the rasterizer to clip to the
+// window.
+// every item is drawn at the coarsest level of detail whose error stays under a pixel (scaled by
+// the LOD bias).
+// each thread writes into its own ThreadLines/ThreadTriangles so the caller can submit them
+// without locking.
+// nothing in a frame allocates once the buffers have grown to the largest frame seen: per item
+// scratch comes from a FrameArena reset every render(), everything else keeps its capacity.
+template <Numeric N>
+class FramePipeline {
+public:
+    // vertices per transform task, small meshes and instances are batched up to this
+    static constexpr std::size_t VERTEX_CHUNK = 4096;
+    static constexpr std::size_t EDGE_CHUNK = 4096;
+
+    explicit FramePipeline(JobSystem& jobs) : jobs{jobs}, lines(jobs.thread_count()), triangles(jobs.thread_count()) {}
+
+    RenderMode render_mode() const {
+        return mode;
+    }
+
+    void set_render_mode(RenderMode m) {
+        mode = m;
+    }
+
+    // each step of 1 doubles the on screen error allowed when picking a level of detail, so
+    // positive values trade quality for speed and negative ones the other way round
+    double lod_bias() const {
+        return bias;
+    }
+
+    void set_lod_bias(double b) {
+        bias = b;
+    }
+
+    // cull every mesh against the frustum one by one
+    void render(const std::vector<Mesh<N>>& meshes, const Mat4<N>& view_proj, const Viewport& vp) {
+        // a bare mesh list carries no version to tell whether it changed
+        drawn.reset();
+        reused = false;
+        const Frustum<N> frustum (view_proj);
+        visible.clear();
+        std::size_t triangles = 0;
+        for (const Mesh<N>& m : meshes) {
+            triangles += m.triangle_count();
+            if (frustum.intersects(m.bounds)) {
+                visible.push_back(&m);
+            }
+        }
+        items.clear();
+        add_meshes();
+        draw_visible(meshes.size(), triangles, view_proj, vp);
+    }
+
+    // only the meshes and instances the scene's BVH finds in the frustum. if the scene, camera
+    // and settings are all as they were for the last call, its output is still right and is kept
+    // as it is without doing any work, see reused_last_frame().
+    void render(const Scene<N>& scene, const Mat4<N>& view_proj, const Viewport& vp) {
+        const DrawnState state {&scene, scene.version(), view_proj, vp.width, vp.height, mode, bias};
+        reused = drawn && *drawn == state;
+        if (reused) {
+            return;
+        }
+        drawn = state;
+        {
+            PROFILE_SCOPE("cull");
+            scene.query(Frustum<N>(view_proj), visible, visible_instances);
+        }
+        items.clear();
+        add_meshes();
+        // instances come sorted by set, so instances of one geometry sit next to each other and
+        // its vertices stay in cache while they're transformed
+        for (const typename Scene<N>::InstanceId& id : visible_instances) {
+            const InstanceSet<N>& set = scene.instance_set(id.set);
+            const uint32_t c = set.colours[id.index];
+            items.push_back(DrawItem<N>{set.geometry.get(), set.transforms[id.index].matrix(),
+                static_cast<int>(c >> 16), static_cast<int>((c >> 8) & 0xff), static_cast<int>(c & 0xff)});
+        }
+        draw_visible(scene.size(), scene.triangles(), view_proj, vp);
+    }
+
+    // whether the last render() kept the output of the one before, so whatever was made from it
+    // (rasterized pixels, line batches) can be presented again as it is
+    bool reused_last_frame() const {
+        return reused;
+    }
+
+    const FrameStats& frame_stats() const {
+        return stats;
+    }
+
+    // segments produced by each thread during the last WIREFRAME render()
+    const std::vector<ThreadLines>& thread_lines() const {
+        return lines;
+    }
+
+    // triangles produced by each thread during the last SOLID render()
+    const std::vector<ThreadTriangles>& thread_triangles() const {
+        return triangles;
+    }
+
+private:
+    JobSystem& jobs;
+    RenderMode mode = RenderMode::WIREFRAME;
+    double bias = 0;
+
+    FrameStats stats;
+
+    // what the current output was drawn from
+    struct DrawnState {
+        const Scene<N>* scene;
+        uint64_t version;
+        Mat4<N> view_proj;
+        int width;
+        int height;
+        RenderMode mode;
+        double bias;
+
+        bool operator==(const DrawnState&) const = default;
+    };
+    std::optional<DrawnState> drawn;
+    bool reused = false;
+
+    std::vector<const Mesh<N>*> visible;
+    std::vector<typename Scene<N>::InstanceId> visible_instances;
+    std::vector<DrawItem<N>> items;
+
+    // transform results, kept between frames to reuse their storage. an item gets the slot
+    // matching its rank by vertex count, so each slot settles at the size of the largest item of
+    // that rank rather than growing whenever a bigger item lands on it.
+    std::vector<ScreenArray<N>> screen;
+
+    // per frame scratch, all of it in arena and gone at the next render()
+    FrameArena arena;
+    std::size_t* slot = nullptr; // per item, index into screen
+    Mat4<N>* mvp = nullptr; // per item, model space -> clip space
+    uint8_t** codes = nullptr; // per item, outcode of each vertex
+    uint8_t** facing = nullptr; // per item, whether each face is turned towards the eye
+    std::size_t* backfacing = nullptr; // per item, how many faces aren't
+    std::size_t* offsets = nullptr; // see emit_lines() and emit_triangles()
+
+    std::vector<ThreadLines> lines;
+    std::vector<ThreadTriangles> triangles;
+
+    void add_meshes() {
+        for (const Mesh<N>* m : visible) {
+            items.push_back(DrawItem<N>{m->geometry.get(), m->model, m->red, m->green, m->blue});
+        }
+    }
+
+    // transform and clip everything in items, mesh_count and triangle_count are the totals they
+    // were picked from
+    void draw_visible(std::size_t mesh_count, std::size_t triangle_count, const Mat4<N>& view_proj, const Viewport& vp) {
+        arena.reset();
+        for (ThreadLines& t : lines) {
+            t.segments.clear();
+            t.culled = 0;
+            t.clipped = 0;
+        }
+        for (ThreadTriangles& t : triangles) {
+            t.triangles.clear();
+        }
+
+        stats = FrameStats{};
+        stats.meshes_drawn = items.size();
+
+        // the coarsest level of detail each item can get away with
+        std::size_t vertex_count = 0;
+        {
+            PROFILE_SCOPE("lod");
+            const double pixel_scale = lod_pixel_scale(view_proj, vp);
+            const double max_pixels = LOD_PIXEL_ERROR * std::exp2(bias);
+            for (DrawItem<N>& item : items) {
+                const std::size_t full = item.geometry->faces.size();
+                item.geometry = &select_lod(*item.geometry, item.model, view_proj, pixel_scale, max_pixels);
+                stats.triangles_drawn += item.geometry->faces.size();
+                stats.triangles_simplified += full - item.geometry->faces.size();
+                vertex_count += item.geometry->verts.size();
+            }
+        }
+        stats.meshes_culled = mesh_count - stats.meshes_drawn;
+        stats.triangles_culled = triangle_count - stats.triangles_drawn - stats.triangles_simplified;
+        stats.vertices_transformed = vertex_count;
+
+        const bool cull_backfaces = mode != RenderMode::WIREFRAME;
+
+        // biggest item first into slot 0
+        slot = arena.allocate<std::size_t>(items.size());
+        std::size_t* order = arena.allocate<std::size_t>(items.size());
+        for (std::size_t i = 0; i < items.size(); i++) {
+            order[i] = i;
+        }
+        std::sort(order, order + items.size(), [&](std::size_t a, std::size_t b) {
+            return items[a].geometry->verts.size() > items[b].geometry->verts.size();
+        });
+        for (std::size_t r = 0; r < items.size(); r++) {
+            slot[order[r]] = r;
+        }
+        if (screen.size() < items.size()) {
+            screen.resize(items.size());
+        }
+
+        codes = arena.allocate<uint8_t*>(items.size());
+        facing = arena.allocate<uint8_t*>(items.size());
+        backfacing = arena.allocate<std::size_t>(items.size());
+        for (std::size_t i = 0; i < items.size(); i++) {
+            const Geometry<N>& g = *items[i].geometry;
+            codes[i] = arena.allocate<uint8_t>(g.verts.padded_size());
+            facing[i] = cull_backfaces ? arena.allocate<uint8_t>(g.faces.size()) : nullptr;
+            backfacing[i] = 0;
+        }
+
+        // model -> clip -> normalized device -> window, once per shared vertex. the mesh's transform
+        // is folded into the view-projection matrix so model space vertices go straight to clip
+        // space, and from there to window space in the same pass. window positions of vertices
+        // outside the near/far planes or guard band are garbage, codes says which those are, and
+        // the clip space positions of those are recomputed from mvp where they're clipped.
+        mvp = arena.allocate<Mat4<N>>(items.size());
+        const std::size_t average = items.empty() ? 1 : std::max<std::size_t>(vertex_count / items.size(), 1);
+        const std::size_t chunk = std::max<std::size_t>(VERTEX_CHUNK / average, 1);
+        jobs.parallel_for(items.size(), chunk, [&](std::size_t begin, std::size_t end, unsigned) {
+            PROFILE_SCOPE("transform");
+            for (std::size_t i = begin; i < end; i++) {
+                const DrawItem<N>& item = items[i];
+                mvp[i] = view_proj * item.model;
+                transform_to_window(item.geometry->verts, mvp[i], vp.width, vp.height, codes[i], screen[slot[i]]);
+                if (cull_backfaces) {
+                    backfacing[i] = classify_faces(*item.geometry, eye_position(mvp[i]), facing[i]);
+                }
+            }
+        });
+        if (cull_backfaces) {
+            for (std::size_t i = 0; i < items.size(); i++) {
+                stats.triangles_backfacing += backfacing[i];
+            }
+        }
+
+        if (mode == RenderMode::SOLID) {
+            emit_triangles(vp);
+        } else {
+            emit_lines(vp);
+            for (const ThreadLines& t : lines) {
+                stats.lines_culled += t.culled;
+                stats.lines_clipped += t.clipped;
+            }
+        }
+    }
+
+    // mark the faces of g whose front side eye can see, returns how many it can't. eye is in model
+    // space, where the test gives the same answer as in world space for any rotation, translation
+    // and uniform scale (a mirroring scale also flips the winding). out needs room for a flag per face.
+    static std::size_t classify_faces(const Geometry<N>& g, const Point<N>& eye, uint8_t* out) {
+        std::size_t back = 0;
+        for (std::size_t f = 0; f < g.faces.size(); f++) {
+            const uint32_t a = g.faces[f].a;
+            const Point<N>& n = g.normals[f];
+            const N d = n.x * (eye.x - g.verts.x[a]) + n.y * (eye.y - g.verts.y[a]) + n.z * (eye.z - g.verts.z[a]);
+            out[f] = d > 0;
+            back += d <= 0;
+        }
+        return back;
+    }
+
+    // clipping/culling, each shared edge once
+    void emit_lines(const Viewport& vp) {
+        // edges of every item laid end to end, offsets[i] is where item i starts
+        offsets = arena.allocate<std::size_t>(items.size() + 1);
+        offsets[0] = 0;
+        for (std::size_t i = 0; i < items.size(); i++) {
+            offsets[i + 1] = offsets[i] + items[i].geometry->edges.size();
+        }
+
+        jobs.parallel_for(offsets[items.size()], EDGE_CHUNK, [&](std::size_t begin, std::size_t end, unsigned thread) {
+            PROFILE_SCOPE("clip");
+            ThreadLines& t = lines[thread];
+            std::vector<LineSegment>& out = t.segments;
+
+            std::size_t mi = std::upper_bound(offsets, offsets + items.size() + 1, begin) - offsets - 1;
+            for (std::size_t e = begin; e < end; e++) {
+                while (e >= offsets[mi + 1]) {
+                    mi += 1;
+                }
+                const DrawItem<N>& m = items[mi];
+                const Geometry<N>& g = *m.geometry;
+                const std::size_t ei = e - offsets[mi];
+                const Edge& edge = g.edges[ei];
+
+                // hidden line, an edge between two faces turned away can't be seen
+                if (mode == RenderMode::HIDDEN_LINE) {
+                    const auto [f0, f1] = g.edge_faces[ei];
+                    if (!facing[mi][f0] && (f1 == Geometry<N>::NO_FACE || !facing[mi][f1])) {
+                        continue;
+                    }
+                }
+
+                // both ends outside the same frustum plane, nothing of it can be visible
+                const uint8_t ca = codes[mi][edge.a];
+                const uint8_t cb = codes[mi][edge.b];
+                if (ca & cb) {
+                    t.culled += 1;
+                    continue;
+                }
+
+                // crossing the near/far planes or guard band, clip before dividing by w
+                Point<int> p1 = screen[slot[mi]][edge.a];
+                Point<int> p2 = screen[slot[mi]][edge.b];
+                const bool clipped = (ca | cb) & CLIP_BEFORE_DIVIDE;
+                if (clipped) {
+                    Vec4<N> a = mvp[mi].transform(g.verts[edge.a]);
+                    Vec4<N> b = mvp[mi].transform(g.verts[edge.b]);
+                    if (!clip_segment(a, b)) {
+                        t.culled += 1;
+                        continue;
+                    }
+                    p1 = scale_point_to_win(project_point(a), vp);
+                    p2 = scale_point_to_win(project_point(b), vp);
+                }
+
+                const uint32_t colour = static_cast<uint32_t>(m.red << 16 | m.green << 8 | m.blue);
+                (clipped ? t.cut : t.candidates).push_back(p1.x, p1.y, p2.x, p2.y, colour);
+            }
+
+            // the whole chunk against the window at once, everything in cut counts as clipped
+            const ClipRect window {0, 0, vp.width, vp.height};
+            t.survivors.clear();
+            const SegmentClipStats own = clip_segments(t.candidates, window, t.survivors);
+            const SegmentClipStats near_far = clip_segments(t.cut, window, t.survivors);
+            t.candidates.clear();
+            t.cut.clear();
+            t.culled += own.rejected + near_far.rejected;
+            t.clipped += own.clipped + near_far.accepted + near_far.clipped;
+
+            const SegmentArray& s = t.survivors;
+            for (std::size_t i = 0; i < s.size(); i++) {
+                const int red = s.colour[i] >> 16 & 0xff, green = s.colour[i] >> 8 & 0xff, blue = s.colour[i] & 0xff;
+                out.push_back(LineSegment{s.x1[i], s.y1[i], s.x2[i], s.y2[i], red, green, blue});
+            }
+        });
+    }
+
+    // clipping/culling of every face
+    void emit_triangles(const Viewport& vp) {
+        // faces of every item laid end to end, offsets[i] is where item i starts
+        offsets = arena.allocate<std::size_t>(items.size() + 1);
+        offsets[0] = 0;
+        for (std::size_t i = 0; i < items.size(); i++) {
+            offsets[i + 1] = offsets[i] + items[i].geometry->faces.size();
+        }
+
+        jobs.parallel_for(offsets[items.size()], EDGE_CHUNK, [&](std::size_t begin, std::size_t end, unsigned thread) {
+            PROFILE_SCOPE("clip");
+            std::vector<ScreenTriangle>& out = triangles[thread].triangles;
+
+            std::size_t mi = std::upper_bound(offsets, offsets + items.size() + 1, begin) - offsets - 1;
+            for (std::size_t f = begin; f < end; f++) {
+                while (f >= offsets[mi + 1]) {
+                    mi += 1;
+                }
+                const DrawItem<N>& m = items[mi];
+                const std::size_t fi = f - offsets[mi];
+                if (!facing[mi][fi]) {
+                    continue;
+                }
+                const Face& face = m.geometry->faces[fi];
+
+                // all corners outside the same frustum plane
+                const uint8_t ca = codes[mi][face.a];
+                const uint8_t cb = codes[mi][face.b];
+                const uint8_t cc = codes[mi][face.c];
+                if (ca & cb & cc) {
+                    continue;
+                }
+
+                if (((ca | cb | cc) & CLIP_BEFORE_DIVIDE) == 0) {
+                    const ScreenArray<N>& sa = screen[slot[mi]];
+                    out.push_back(ScreenTriangle{{sa[face.a], sa[face.b], sa[face.c]}, m.red, m.green, m.blue});
+                    continue;
+                }
+
+                // crossing the near/far planes or guard band, clip in clip space and fan the rest
+                const VertexArray<N>& v = m.geometry->verts;
+                Vec4<N> poly[CLIP_POLYGON_MAX] = {mvp[mi].transform(v[face.a]), mvp[mi].transform(v[face.b]), mvp[mi].transform(v[face.c])};
+                const int count = clip_polygon(poly, 3);
+                if (count == 0) {
+                    continue;
+                }
+                const Point<int> first = scale_point_to_win(project_point(poly[0]), vp);
+                Point<int> prev = scale_point_to_win(project_point(poly[1]), vp);
+                for (int i = 2; i < count; i++) {
+                    const Point<int> next = scale_point_to_win(project_point(poly[i]), vp);
+                    out.push_back(ScreenTriangle{{first, prev, next}, m.red, m.green, m.blue});
+                    prev = next;
+                }
+            }
+        });
+    }
+};
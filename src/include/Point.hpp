@@ -0,0 +1,110 @@
+#pragma once
+#include <utility>
+#include <concepts>
+#include <iostream>
+#include <numbers>
+#include <cmath>
+#include <type_traits>
+
+constexpr double PI = std::numbers::pi;
+
+// true for the fixed point types of Fixed.hpp, which count as Numeric alongside the built in ones
+template <typename N>
+inline constexpr bool is_fixed_point_v = false;
+
+template<typename N>
+concept Numeric = requires(N n)
+{
+    requires std::is_integral_v<N> || std::is_floating_point_v<N> || is_fixed_point_v<N>;
+    requires !std::is_same_v<bool, N>;
+    requires std::is_arithmetic_v<decltype(n + 1)> || is_fixed_point_v<decltype(n + 1)>;
+    requires !std::is_pointer_v<N>;
+};
+
+// square root in N's own precision: float and double use their std overloads rather than being
+// widened, integers go through double and fixed point types bring their own overload
+template <Numeric N>
+N num_sqrt(N v) {
+    if constexpr (std::is_floating_point_v<N>) {
+        return std::sqrt(v);
+    } else {
+        return static_cast<N>(std::sqrt(static_cast<double>(v)));
+    }
+}
+
+template <Numeric N>
+struct Point {
+    N x;
+    N y;
+    N z;
+
+    Point(N x, N y, N z) : x{x}, y{y}, z{z} {}
+
+    template <Numeric M>
+    Point(M x, M y, M z) : x{static_cast<N>(x)}, y{static_cast<N>(y)}, z{static_cast<N>(z)} {}
+
+    template <Numeric M>
+    operator Point<M>() const {
+        return Point<M>(
+            static_cast<M>(x),
+            static_cast<M>(y),
+            static_cast<M>(z)
+        );
+    }
+
+    bool operator==(const Point&) const = default;
+
+    template <Numeric M>
+    Point& operator+=(const Point<M>& rhs) {
+        this->x += static_cast<N>(rhs.x);
+        this->y += static_cast<N>(rhs.y);
+        this->z += static_cast<N>(rhs.z);
+        return *this;
+    }
+
+    template <Numeric M>
+    Point& operator-=(const Point<M>& rhs) {
+        this->x -= static_cast<N>(rhs.x);
+        this->y -= static_cast<N>(rhs.y);
+        this->z -= static_cast<N>(rhs.z);
+        return *this;
+    }
+
+    template <Numeric M>
+    Point& operator*=(const Point<M>& rhs) {
+        this->x *= static_cast<N>(rhs.x);
+        this->y *= static_cast<N>(rhs.y);
+        this->z *= static_cast<N>(rhs.z);
+        return *this;
+    }
+
+    template <Numeric M>
+    friend Point<decltype(std::declval<N>() + std::declval<M>())> operator+(const Point<N>& lhs, const Point<M>& rhs);
+
+    template <Numeric M>
+    friend Point<decltype(std::declval<N>() - std::declval<M>())> operator-(const Point<N>& lhs, const Point<M>& rhs);
+
+    template <Numeric M>
+    friend Point<decltype(std::declval<N>() * std::declval<M>())> operator*(const Point<N>& lhs, const Point<M>& rhs);
+
+    template <Numeric M>
+    friend Point<decltype(std::declval<N>() / std::declval<M>())> operator/(const Point<N>& lhs, const Point<M>& rhs);
+
+    void Display() const {
+        std::cout << "(" << x << "," << y << "," << z << ")";
+    }
+};
+
+template <Numeric N, Numeric M>
+Point<decltype(std::declval<N>() + std::declval<M>())> operator+(const Point<N>& lhs, const Point<M>& rhs) {
+    using O = decltype(std::declval<N>() + std::declval<M>());
+    return Point<O>(lhs.x + rhs.x, lhs.y + rhs.y, lhs.z + rhs.z);
+}
+
+//template <Numeric N, Numeric M>
+template <Numeric N, Numeric M, Numeric O = decltype(std::declval<N>() - std::declval<M>())>
+Point<O> operator+(const Point<N>& lhs, const Point<M>& rhs) {
+    //using O = decltype(std::declval<N>() - std::declval<M>());
+    return Point<O>(lhs.x - rhs.x, lhs.y - rhs.y, lhs.z - rhs.z);
+}
+
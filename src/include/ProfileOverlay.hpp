@@ -0,0 +1,48 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include "Profiler.hpp"
+#include "LineBatch.hpp"
+#include "Camera.hpp"
+
+constexpr std::size_t OVERLAY_FRAMES = 120;
+constexpr int OVERLAY_COLUMN = 3; // pixels per frame
+constexpr double OVERLAY_PIXELS_PER_MS = 8.0;
+
+// graph of the last OVERLAY_FRAMES frames in the bottom left corner of the window. each frame is
+// a column with its stages stacked bottom up, one colour per stage, and the rest of the frame
+// time in grey above them. horizontal lines mark 60 and 30 frames per second.
+inline void draw_profile_overlay(const Profiler& p, LineBatch& batch, const Viewport& vp) {
+    static constexpr int PALETTE[][3] = {
+        {230, 25, 75}, {60, 180, 75}, {255, 225, 25}, {0, 130, 200},
+        {245, 130, 48}, {145, 30, 180}, {70, 240, 240}, {240, 50, 230},
+    };
+    const std::vector<ProfileFrame>& frames = p.frame_history();
+    const std::size_t first = frames.size() > OVERLAY_FRAMES ? frames.size() - OVERLAY_FRAMES : 0;
+    const int bottom = vp.height - 1;
+    const auto bar = [&](int x, int from, int to, int red, int green, int blue) {
+        if (to > from) {
+            batch.add(LineSegment{x, std::max(bottom - from, 0), x, std::max(bottom - to, 0), red, green, blue});
+        }
+    };
+
+    for (std::size_t f = first; f < frames.size(); f++) {
+        const ProfileFrame& frame = frames[f];
+        const int x = static_cast<int>(f - first) * OVERLAY_COLUMN;
+        int height = 0;
+        for (std::size_t s = 0; s < frame.stage_ms.size(); s++) {
+            const int h = static_cast<int>(frame.stage_ms[s] * OVERLAY_PIXELS_PER_MS);
+            const int* c = PALETTE[s % std::size(PALETTE)];
+            bar(x, height, height + h, c[0], c[1], c[2]);
+            height += h;
+        }
+        const int total = static_cast<int>((frame.end_ns - frame.start_ns) / 1e6 * OVERLAY_PIXELS_PER_MS);
+        bar(x, height, total, 96, 96, 96);
+    }
+
+    const int width = static_cast<int>(OVERLAY_FRAMES) * OVERLAY_COLUMN;
+    for (const double ms : {1000.0 / 60.0, 1000.0 / 30.0}) {
+        const int y = bottom - static_cast<int>(ms * OVERLAY_PIXELS_PER_MS);
+        batch.add(LineSegment{0, y, width, y, 255, 255, 255});
+    }
+}
@@ -0,0 +1,294 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include "SpscRing.hpp"
+
+// scoped stage timers and per frame counters. build with -DENGINE_PROFILE to turn them on, without
+// it PROFILE_SCOPE, PROFILE_COUNTER and PROFILE_FRAME expand to nothing and no profiling code is
+// left in the hot paths.
+//
+// every thread records into its own lock-free ring, the main thread drains them all once a frame
+// in end_frame() into per frame summaries (for the overlay and csv) and a trace log (for chrome's
+// about:tracing / perfetto).
+
+// one timed scope or counter sample. name must be a string literal (or otherwise outlive the
+// profiler), only the pointer is stored.
+struct ProfileEvent {
+    const char* name;
+    int64_t start_ns; // since the profiler started
+    int64_t value; // duration in ns for timers, the sample for counters
+    uint32_t thread;
+    bool counter;
+};
+
+// what one frame spent per stage and the counters recorded during it
+struct ProfileFrame {
+    int64_t start_ns;
+    int64_t end_ns;
+    std::vector<double> stage_ms; // wall time from first start to last end, by Profiler::stage_names()
+    std::vector<int64_t> counters; // by Profiler::counter_names(), -1 when not recorded
+};
+
+class Profiler {
+public:
+    static constexpr std::size_t MAX_THREADS = 64;
+    static constexpr std::size_t RING_CAPACITY = 1 << 14;
+
+    // trace export keeps at most this many events, later ones only reach the frame summaries
+    static constexpr std::size_t TRACE_MAX_EVENTS = 1 << 20;
+
+    Profiler() : epoch{clock::now()}, frame_start{0} {}
+
+    ~Profiler() {
+        for (std::atomic<Ring*>& r : rings) {
+            delete r.load(std::memory_order_acquire);
+        }
+    }
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    int64_t now_ns() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - epoch).count();
+    }
+
+    // safe from any thread
+    void record(const char* name, int64_t start_ns, int64_t value, bool counter) {
+        Ring* ring = thread_ring();
+        if (ring) {
+            ring->push(ProfileEvent{name, start_ns, value, thread_index(), counter});
+        }
+    }
+
+    // main thread only. closes the frame that began at the previous end_frame().
+    void end_frame() {
+        ProfileFrame frame {frame_start, now_ns(), std::vector<double>(stages.size(), 0.0), std::vector<int64_t>(counter_ids.size(), -1)};
+        std::vector<std::pair<int64_t, int64_t>> spans (stages.size(), {INT64_MAX, INT64_MIN});
+
+        for (std::atomic<Ring*>& r : rings) {
+            Ring* ring = r.load(std::memory_order_acquire);
+            if (!ring) {
+                continue;
+            }
+            ring->drain([&](const ProfileEvent& e) {
+                if (trace.size() < TRACE_MAX_EVENTS) {
+                    trace.push_back(e);
+                }
+                if (e.counter) {
+                    const std::size_t id = lookup(counter_ids, e.name);
+                    frame.counters.resize(counter_ids.size(), -1);
+                    frame.counters[id] = std::max<int64_t>(frame.counters[id], 0) + e.value;
+                    return;
+                }
+                const std::size_t id = lookup(stages, e.name);
+                frame.stage_ms.resize(stages.size(), 0.0);
+                spans.resize(stages.size(), {INT64_MAX, INT64_MIN});
+                spans[id].first = std::min(spans[id].first, e.start_ns);
+                spans[id].second = std::max(spans[id].second, e.start_ns + e.value);
+            });
+        }
+        for (std::size_t i = 0; i < spans.size(); i++) {
+            if (spans[i].first <= spans[i].second) {
+                frame.stage_ms[i] = (spans[i].second - spans[i].first) / 1e6;
+            }
+        }
+        frames.push_back(std::move(frame));
+        frame_start = frames.back().end_ns;
+    }
+
+    const std::vector<ProfileFrame>& frame_history() const {
+        return frames;
+    }
+
+    const std::vector<const char*>& stage_names() const {
+        return stages;
+    }
+
+    const std::vector<const char*>& counter_names() const {
+        return counter_ids;
+    }
+
+    // events lost to full rings, non zero means end_frame() isn't keeping up
+    std::size_t dropped_events() const {
+        std::size_t n = 0;
+        for (const std::atomic<Ring*>& r : rings) {
+            const Ring* ring = r.load(std::memory_order_acquire);
+            n += ring ? ring->dropped_count() : 0;
+        }
+        return n;
+    }
+
+    // mean per frame of every stage and counter
+    void write_summary(std::ostream& out) const {
+        if (frames.empty()) {
+            return;
+        }
+        std::vector<double> stage_total (stages.size(), 0.0);
+        std::vector<double> counter_total (counter_ids.size(), 0.0);
+        double frame_total = 0;
+        for (const ProfileFrame& frame : frames) {
+            frame_total += (frame.end_ns - frame.start_ns) / 1e6;
+            for (std::size_t i = 0; i < frame.stage_ms.size(); i++) {
+                stage_total[i] += frame.stage_ms[i];
+            }
+            for (std::size_t i = 0; i < frame.counters.size(); i++) {
+                counter_total[i] += std::max<int64_t>(frame.counters[i], 0);
+            }
+        }
+        const double n = static_cast<double>(frames.size());
+        out << "profile, mean of " << frames.size() << " frames: frame " << frame_total / n << " ms";
+        for (std::size_t i = 0; i < stages.size(); i++) {
+            out << ", " << stages[i] << ' ' << stage_total[i] / n << " ms";
+        }
+        for (std::size_t i = 0; i < counter_ids.size(); i++) {
+            out << ", " << counter_ids[i] << ' ' << counter_total[i] / n;
+        }
+        out << std::endl;
+    }
+
+    // chrome trace event format, complete events for timers and counter events for counters
+    bool write_chrome_trace(const std::string& path) const {
+        std::ofstream out (path);
+        if (!out) {
+            return false;
+        }
+        out << "{\"traceEvents\":[\n";
+        bool first = true;
+        for (const ProfileEvent& e : trace) {
+            out << (first ? "" : ",\n");
+            first = false;
+            if (e.counter) {
+                out << "{\"name\":\"" << e.name << "\",\"ph\":\"C\",\"ts\":" << e.start_ns / 1e3
+                    << ",\"pid\":0,\"tid\":" << e.thread << ",\"args\":{\"value\":" << e.value << "}}";
+            } else {
+                out << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"ts\":" << e.start_ns / 1e3
+                    << ",\"dur\":" << e.value / 1e3 << ",\"pid\":0,\"tid\":" << e.thread << "}";
+            }
+        }
+        out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+        return static_cast<bool>(out);
+    }
+
+    // one row per frame: frame, frame_ms, then each stage's ms and each counter
+    bool write_csv(const std::string& path) const {
+        std::ofstream out (path);
+        if (!out) {
+            return false;
+        }
+        out << "frame,frame_ms";
+        for (const char* s : stages) {
+            out << ',' << s << "_ms";
+        }
+        for (const char* c : counter_ids) {
+            out << ',' << c;
+        }
+        out << '\n';
+        for (std::size_t f = 0; f < frames.size(); f++) {
+            const ProfileFrame& frame = frames[f];
+            out << f << ',' << (frame.end_ns - frame.start_ns) / 1e6;
+            for (std::size_t i = 0; i < stages.size(); i++) {
+                out << ',';
+                if (i < frame.stage_ms.size()) {
+                    out << frame.stage_ms[i];
+                }
+            }
+            for (std::size_t i = 0; i < counter_ids.size(); i++) {
+                out << ',';
+                if (i < frame.counters.size() && frame.counters[i] >= 0) {
+                    out << frame.counters[i];
+                }
+            }
+            out << '\n';
+        }
+        return static_cast<bool>(out);
+    }
+
+private:
+    using clock = std::chrono::steady_clock;
+    using Ring = SpscRing<ProfileEvent, RING_CAPACITY>;
+
+    const clock::time_point epoch;
+    int64_t frame_start;
+
+    std::atomic<Ring*> rings[MAX_THREADS] {};
+    std::atomic<uint32_t> next_thread {0};
+
+    // main thread only
+    std::vector<const char*> stages;
+    std::vector<const char*> counter_ids;
+    std::vector<ProfileFrame> frames;
+    std::vector<ProfileEvent> trace;
+
+    // small per thread id, handed out on a thread's first event. threads past MAX_THREADS get no
+    // ring and their events are ignored.
+    uint32_t thread_index() {
+        thread_local const uint32_t index = next_thread.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+
+    Ring* thread_ring() {
+        const uint32_t index = thread_index();
+        if (index >= MAX_THREADS) {
+            return nullptr;
+        }
+        Ring* ring = rings[index].load(std::memory_order_relaxed);
+        if (!ring) {
+            ring = new Ring();
+            rings[index].store(ring, std::memory_order_release);
+        }
+        return ring;
+    }
+
+    static std::size_t lookup(std::vector<const char*>& names, const char* name) {
+        for (std::size_t i = 0; i < names.size(); i++) {
+            if (names[i] == name || std::strcmp(names[i], name) == 0) {
+                return i;
+            }
+        }
+        names.push_back(name);
+        return names.size() - 1;
+    }
+};
+
+inline Profiler& profiler() {
+    static Profiler p;
+    return p;
+}
+
+// times the enclosing scope
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name) : name{name}, start{profiler().now_ns()} {}
+
+    ~ProfileScope() {
+        profiler().record(name, start, profiler().now_ns() - start, false);
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name;
+    int64_t start;
+};
+
+#ifdef ENGINE_PROFILE
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__) (name)
+#define PROFILE_COUNTER(name, value) profiler().record((name), profiler().now_ns(), static_cast<int64_t>(value), true)
+#define PROFILE_FRAME() profiler().end_frame()
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_COUNTER(name, value) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#endif
@@ -0,0 +1,268 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include "Point.hpp"
+#include "VertexArray.hpp"
+#include "Simd.hpp"
+#include "Framebuffer.hpp"
+#include "Pipeline.hpp"
+
+// filled triangles with a depth test, rasterized with half-space (edge function) tests over
+// RASTER_BLOCK x RASTER_BLOCK pixel blocks. each block is classified against the three edges
+// first: blocks outside any edge are skipped, edges a block is fully inside of aren't tested per
+// pixel. pixels are sampled at their integer coordinates, shared edges follow the top-left rule
+// so neighbouring triangles never both cover a pixel.
+
+// pixel rectangle [x0, x1) x [y0, y1)
+struct RasterRect {
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+};
+
+// per triangle constants for the block kernels
+struct TriangleSetup {
+    // edge functions E(x, y) = a*x + b*y + c, inside where E >= 0. c includes the fill rule bias.
+    int64_t a[3];
+    int64_t b[3];
+    int64_t c[3];
+
+    // fixed point depth at pixel (x, y) is z0 + dzdx*x + dzdy*y
+    double z0;
+    double dzdx;
+    double dzdy;
+
+    uint32_t colour;
+
+    // bounding box clipped to the target rectangle, max exclusive
+    int min_x;
+    int min_y;
+    int max_x;
+    int max_y;
+};
+
+// false if t covers no pixel of r
+inline bool setup_triangle(const ScreenTriangle& t, const RasterRect& r, TriangleSetup& s) {
+    Point<int> v0 = t.v[0];
+    Point<int> v1 = t.v[1];
+    Point<int> v2 = t.v[2];
+
+    // wind every triangle the same way so inside is always E >= 0
+    int64_t area = static_cast<int64_t>(v1.x - v0.x) * (v2.y - v0.y) - static_cast<int64_t>(v1.y - v0.y) * (v2.x - v0.x);
+    if (area == 0) {
+        return false;
+    } else if (area < 0) {
+        std::swap(v1, v2);
+        area = -area;
+    }
+
+    s.min_x = std::max(std::min({v0.x, v1.x, v2.x}), r.x0);
+    s.min_y = std::max(std::min({v0.y, v1.y, v2.y}), r.y0);
+    s.max_x = std::min(std::max({v0.x, v1.x, v2.x}) + 1, r.x1);
+    s.max_y = std::min(std::max({v0.y, v1.y, v2.y}) + 1, r.y1);
+    if (s.min_x >= s.max_x || s.min_y >= s.max_y) {
+        return false;
+    }
+
+    const Point<int>* p[3] = {&v0, &v1, &v2};
+    for (int i = 0; i < 3; i++) {
+        const Point<int>& from = *p[i];
+        const Point<int>& to = *p[(i + 1) % 3];
+        s.a[i] = from.y - to.y;
+        s.b[i] = to.x - from.x;
+        s.c[i] = static_cast<int64_t>(to.y - from.y) * from.x - static_cast<int64_t>(to.x - from.x) * from.y;
+
+        // top-left rule, pixels exactly on any other edge belong to the neighbouring triangle
+        const bool top_left = s.a[i] > 0 || (s.a[i] == 0 && s.b[i] > 0);
+        if (!top_left) {
+            s.c[i] -= 1;
+        }
+    }
+
+    const double dz1 = static_cast<double>(v1.z) - v0.z;
+    const double dz2 = static_cast<double>(v2.z) - v0.z;
+    s.dzdx = (dz1 * (v2.y - v0.y) - dz2 * (v1.y - v0.y)) / area;
+    s.dzdy = (dz2 * (v1.x - v0.x) - dz1 * (v2.x - v0.x)) / area;
+    s.z0 = v0.z - s.dzdx * v0.x - s.dzdy * v0.y;
+
+    s.colour = Framebuffer::pack(t.red, t.green, t.blue);
+    return true;
+}
+
+// true if every pixel of the extent x extent square with its top left pixel at (x, y) is outside
+// one of s's edges
+inline bool square_outside(const TriangleSetup& s, int x, int y, int extent) {
+    for (int i = 0; i < 3; i++) {
+        const int64_t v = s.a[i] * x + s.b[i] * y + s.c[i];
+        if (v + std::max<int64_t>(s.a[i], 0) * (extent - 1) + std::max<int64_t>(s.b[i], 0) * (extent - 1) < 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// one block with its top left pixel at (bx, by). only pixels in [x0, x1) x [y0, y1) are touched,
+// e holds the edge functions at (bx, by) for the edges whose bit is set in partial, the other
+// edges contain the whole block.
+
+namespace scalar {
+
+inline void fill_block(Framebuffer& fb, const TriangleSetup& s, int bx, int by, int x0, int y0, int x1, int y1, const int32_t (&e)[3], int partial) {
+    for (int y = y0; y < y1; y++) {
+        const double zr = s.z0 + s.dzdy * y;
+        uint32_t* colour = &fb.pixels[static_cast<std::size_t>(y) * fb.stride];
+        uint32_t* depth = &fb.depth[static_cast<std::size_t>(y) * fb.stride];
+        for (int x = x0; x < x1; x++) {
+            bool inside = true;
+            for (int i = 0; i < 3; i++) {
+                if ((partial & (1 << i)) && e[i] + s.a[i] * (x - bx) + s.b[i] * (y - by) < 0) {
+                    inside = false;
+                }
+            }
+            if (!inside) {
+                continue;
+            }
+            const double zf = std::clamp(zr + s.dzdx * x, 0.0, static_cast<double>(DEPTH_MAX));
+            const uint32_t z = static_cast<uint32_t>(zf);
+            if (z < depth[x]) {
+                depth[x] = z;
+                colour[x] = s.colour;
+            }
+        }
+    }
+}
+
+} // namespace scalar
+
+#if ENGINE_SIMD_X86
+namespace sse2 {
+
+// a block row is two groups of 4 lanes. edge values stay well inside int32 here since only edges
+// crossing the block are evaluated, and depth fits in 24 bits so signed compares are fine. depth
+// is interpolated in double, two lanes at a time, with the same operations in the same order as
+// the scalar kernel, so both resolve every depth test the same way (a float's 24 bit mantissa
+// can't hold depths near DEPTH_MAX).
+__attribute__((target("sse2")))
+inline void fill_block(Framebuffer& fb, const TriangleSetup& s, int bx, int by, int x0, int y0, int x1, int y1, const int32_t (&e)[3], int partial) {
+    const __m128i lane = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i lo = _mm_set1_epi32(x0 - 1);
+    const __m128i hi = _mm_set1_epi32(x1);
+    const __m128i minus_one = _mm_set1_epi32(-1);
+    const __m128i colour = _mm_set1_epi32(static_cast<int>(s.colour));
+    const __m128d zmax = _mm_set1_pd(static_cast<double>(DEPTH_MAX));
+    const __m128d zmin = _mm_setzero_pd();
+    const __m128d dzdx = _mm_set1_pd(s.dzdx);
+
+    // per half: pixel x, edge values on the first row and dzdx * x for each pair of pixels
+    __m128i xs[2];
+    __m128i ev[2][3];
+    __m128d zx[2][2];
+    for (int h = 0; h < 2; h++) {
+        xs[h] = _mm_add_epi32(_mm_set1_epi32(bx + 4*h), lane);
+        for (int i = 0; i < 3; i++) {
+            const int32_t a = static_cast<int32_t>(s.a[i]);
+            const int32_t b0 = e[i] + a * 4*h + static_cast<int32_t>(s.b[i]) * (y0 - by);
+            ev[h][i] = _mm_setr_epi32(b0, b0 + a, b0 + 2*a, b0 + 3*a);
+        }
+        zx[h][0] = _mm_mul_pd(dzdx, _mm_setr_pd(bx + 4*h, bx + 4*h + 1));
+        zx[h][1] = _mm_mul_pd(dzdx, _mm_setr_pd(bx + 4*h + 2, bx + 4*h + 3));
+    }
+    const __m128i eb[3] = {
+        _mm_set1_epi32(static_cast<int32_t>(s.b[0])),
+        _mm_set1_epi32(static_cast<int32_t>(s.b[1])),
+        _mm_set1_epi32(static_cast<int32_t>(s.b[2]))
+    };
+
+    for (int y = y0; y < y1; y++) {
+        const __m128d zr = _mm_set1_pd(s.z0 + s.dzdy * y);
+        for (int h = 0; h < 2; h++) {
+            if (bx + 4*h >= x1 || bx + 4*h + 4 <= x0) {
+                continue;
+            }
+            __m128i mask = _mm_and_si128(_mm_cmpgt_epi32(xs[h], lo), _mm_cmplt_epi32(xs[h], hi));
+            for (int i = 0; i < 3; i++) {
+                if (partial & (1 << i)) {
+                    mask = _mm_and_si128(mask, _mm_cmpgt_epi32(ev[h][i], minus_one));
+                }
+            }
+            if (_mm_movemask_epi8(mask) == 0) {
+                continue;
+            }
+
+            const std::size_t offset = static_cast<std::size_t>(y) * fb.stride + bx + 4*h;
+            __m128i* dp = reinterpret_cast<__m128i*>(&fb.depth[offset]);
+            __m128i* cp = reinterpret_cast<__m128i*>(&fb.pixels[offset]);
+            const __m128i z01 = _mm_cvttpd_epi32(_mm_min_pd(_mm_max_pd(_mm_add_pd(zr, zx[h][0]), zmin), zmax));
+            const __m128i z23 = _mm_cvttpd_epi32(_mm_min_pd(_mm_max_pd(_mm_add_pd(zr, zx[h][1]), zmin), zmax));
+            const __m128i z = _mm_unpacklo_epi64(z01, z23);
+            const __m128i old = _mm_loadu_si128(dp);
+            mask = _mm_and_si128(mask, _mm_cmplt_epi32(z, old));
+            if (_mm_movemask_epi8(mask) == 0) {
+                continue;
+            }
+            _mm_storeu_si128(dp, _mm_or_si128(_mm_and_si128(mask, z), _mm_andnot_si128(mask, old)));
+            _mm_storeu_si128(cp, _mm_or_si128(_mm_and_si128(mask, colour), _mm_andnot_si128(mask, _mm_loadu_si128(cp))));
+        }
+        for (int h = 0; h < 2; h++) {
+            for (int i = 0; i < 3; i++) {
+                ev[h][i] = _mm_add_epi32(ev[h][i], eb[i]);
+            }
+        }
+    }
+}
+
+} // namespace sse2
+#endif
+
+// the triangle s was set up for, over the pixels in its (clipped) bounding box
+inline void fill_setup(Framebuffer& fb, const TriangleSetup& s) {
+#if ENGINE_SIMD_X86
+    const bool simd = detect_simd_level() != SimdLevel::SCALAR;
+#endif
+
+    constexpr int last = RASTER_BLOCK - 1;
+    const int first_bx = s.min_x / RASTER_BLOCK * RASTER_BLOCK;
+    const int first_by = s.min_y / RASTER_BLOCK * RASTER_BLOCK;
+    for (int by = first_by; by < s.max_y; by += RASTER_BLOCK) {
+        for (int bx = first_bx; bx < s.max_x; bx += RASTER_BLOCK) {
+            // classify the block against each edge using its extreme corners
+            int32_t e[3];
+            int partial = 0;
+            bool outside = false;
+            for (int i = 0; i < 3; i++) {
+                const int64_t v = s.a[i] * bx + s.b[i] * by + s.c[i];
+                const int64_t lo = v + std::min<int64_t>(s.a[i], 0) * last + std::min<int64_t>(s.b[i], 0) * last;
+                const int64_t hi = v + std::max<int64_t>(s.a[i], 0) * last + std::max<int64_t>(s.b[i], 0) * last;
+                if (hi < 0) {
+                    outside = true;
+                    break;
+                }
+                if (lo < 0) {
+                    partial |= 1 << i;
+                    e[i] = static_cast<int32_t>(v);
+                } else {
+                    e[i] = 0;
+                }
+            }
+            if (outside) {
+                continue;
+            }
+
+            const int x0 = std::max(bx, s.min_x);
+            const int y0 = std::max(by, s.min_y);
+            const int x1 = std::min(bx + RASTER_BLOCK, s.max_x);
+            const int y1 = std::min(by + RASTER_BLOCK, s.max_y);
+#if ENGINE_SIMD_X86
+            if (simd) {
+                sse2::fill_block(fb, s, bx, by, x0, y0, x1, y1, e, partial);
+                continue;
+            }
+#endif
+            scalar::fill_block(fb, s, bx, by, x0, y0, x1, y1, e, partial);
+        }
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+#include "LineBatch.hpp"
+#include "Framebuffer.hpp"
+
+// where a frame's clipped geometry ends up. the SDL window (SdlBackend.hpp) and the in-memory
+// framebuffer used on headless machines (SoftwareBackend.hpp) both implement this.
+class RenderBackend {
+public:
+    virtual ~RenderBackend() = default;
+
+    virtual void clear(int red, int green, int blue) = 0;
+
+    // draw every segment of batch, returns the number of draw calls it took
+    virtual int draw_lines(const LineBatch& batch) = 0;
+
+    // cover the whole target with frame's pixels, frame is the same size as the target
+    virtual void draw_framebuffer(const Framebuffer& frame) = 0;
+
+    virtual void present() = 0;
+
+    // status text, the window title for SDL
+    virtual void set_title(const std::string&) {}
+};
@@ -0,0 +1,439 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <cstdint>
+#include <algorithm>
+#include <cstddef>
+#include "Point.hpp"
+#include "Triangle.hpp"
+#include "Frustum.hpp"
+#include "Transform.hpp"
+#include "Instances.hpp"
+
+// meshes and instances plus a dynamic bounding volume hierarchy over them (an incrementally
+// balanced AABB tree in the style of Box2D's b2DynamicTree). leaves hold a box fattened by
+// AABB_MARGIN so small moves don't touch the tree, anything that leaves its fat box is removed
+// and reinserted in O(log n). instances of the same geometry are kept together in one InstanceSet.
+template <Numeric N>
+class Scene {
+public:
+    using MeshId = std::size_t;
+
+    // instance index of InstanceSet set
+    struct InstanceId {
+        uint32_t set;
+        uint32_t index;
+
+        auto operator<=>(const InstanceId&) const = default;
+    };
+
+    static constexpr N AABB_MARGIN = static_cast<N>(0.1);
+
+    MeshId add(Mesh<N> m) {
+        changes += 1;
+        const MeshId id = meshes.size();
+        triangle_count += m.triangle_count();
+        meshes.push_back(std::move(m));
+
+        const int leaf = allocate_node();
+        nodes[leaf].set = MESH_SET;
+        nodes[leaf].index = static_cast<uint32_t>(id);
+        fatten(leaf, meshes[id].bounds);
+        insert_leaf(leaf);
+        leaves.push_back(leaf);
+        return id;
+    }
+
+    // one more placement of geometry, sharing it with every other instance of it
+    InstanceId add_instance(const GeometryPtr<N>& geometry, const Transform<N>& t, int red, int green, int blue) {
+        changes += 1;
+        const auto [it, inserted] = set_of.try_emplace(geometry.get(), static_cast<uint32_t>(sets.size()));
+        if (inserted) {
+            sets.emplace_back(geometry);
+            instance_leaves.emplace_back();
+        }
+        const uint32_t set = it->second;
+        const uint32_t index = static_cast<uint32_t>(sets[set].add(t, red, green, blue));
+        triangle_count += geometry->faces.size();
+        instance_total += 1;
+
+        const int leaf = allocate_node();
+        nodes[leaf].set = set;
+        nodes[leaf].index = index;
+        fatten(leaf, sets[set].bounds(index));
+        insert_leaf(leaf);
+        instance_leaves[set].push_back(leaf);
+        return InstanceId{set, index};
+    }
+
+    const Mesh<N>& mesh(MeshId id) const {
+        return meshes[id];
+    }
+
+    const std::vector<Mesh<N>>& all_meshes() const {
+        return meshes;
+    }
+
+    const InstanceSet<N>& instance_set(uint32_t set) const {
+        return sets[set];
+    }
+
+    const std::vector<InstanceSet<N>>& instance_sets() const {
+        return sets;
+    }
+
+    // meshes plus instances
+    std::size_t size() const {
+        return meshes.size() + instance_total;
+    }
+
+    std::size_t triangles() const {
+        return triangle_count;
+    }
+
+    // bumped by anything that could change what a frame draws, meshes and instances added or
+    // moved. equal versions mean the scene looks exactly the same.
+    uint64_t version() const {
+        return changes;
+    }
+
+    // Mesh::set_origin followed by an incremental refit of that mesh's leaf
+    template <Numeric M = N>
+    void set_origin(MeshId id, const Point<M>& p) {
+        const uint64_t before = meshes[id].version;
+        meshes[id].set_origin(p);
+        if (meshes[id].version != before) {
+            changes += 1;
+            refit(leaves[id], meshes[id].bounds);
+        }
+    }
+
+    // any other change to a mesh goes through here so the tree sees it, and counts as a change
+    // whatever fn does since colours aren't versioned
+    template <typename F>
+    void modify(MeshId id, F&& fn) {
+        changes += 1;
+        fn(meshes[id]);
+        refit(leaves[id], meshes[id].bounds);
+    }
+
+    void set_transform(InstanceId id, const Transform<N>& t) {
+        changes += 1;
+        sets[id.set].transforms[id.index] = t;
+        refit(instance_leaves[id.set][id.index], sets[id.set].bounds(id.index));
+    }
+
+    // meshes whose bounds intersect the frustum, instances are skipped
+    void query(const Frustum<N>& frustum, std::vector<const Mesh<N>*>& out) const {
+        out.clear();
+        traverse(frustum, [&](uint32_t set, uint32_t index, bool contained) {
+            if (set == MESH_SET && (contained || frustum.intersects(meshes[index].bounds))) {
+                out.push_back(&meshes[index]);
+            }
+        });
+    }
+
+    // meshes and instances intersecting the frustum, instances sorted by set so those sharing a
+    // geometry are adjacent
+    void query(const Frustum<N>& frustum, std::vector<const Mesh<N>*>& out, std::vector<InstanceId>& instances) const {
+        out.clear();
+        instances.clear();
+        traverse(frustum, [&](uint32_t set, uint32_t index, bool contained) {
+            if (set != MESH_SET) {
+                if (contained || frustum.intersects(sets[set].bounds(index))) {
+                    instances.push_back(InstanceId{set, index});
+                }
+            } else if (contained || frustum.intersects(meshes[index].bounds)) {
+                out.push_back(&meshes[index]);
+            }
+        });
+        std::sort(instances.begin(), instances.end());
+    }
+
+private:
+    static constexpr int NULL_NODE = -1;
+    static constexpr uint32_t MESH_SET = UINT32_MAX;
+
+    // fn(set, index, contained) for every leaf whose fat box intersects the frustum, contained if
+    // the box is known to be entirely inside it. subtrees fully inside are taken without further
+    // tests. not safe to call concurrently on the same Scene.
+    template <typename F>
+    void traverse(const Frustum<N>& frustum, F&& fn) const {
+        if (root == NULL_NODE) {
+            return;
+        }
+
+        stack.clear();
+        stack.emplace_back(root, false);
+        while (!stack.empty()) {
+            const auto [index, inside] = stack.back();
+            stack.pop_back();
+            const Node& node = nodes[index];
+
+            bool contained = inside;
+            if (!contained) {
+                if (!frustum.intersects_aabb(node.min, node.max)) {
+                    continue;
+                }
+                contained = frustum.contains_aabb(node.min, node.max);
+            }
+
+            if (node.leaf()) {
+                fn(node.set, node.index, contained);
+            } else {
+                stack.emplace_back(node.child1, contained);
+                stack.emplace_back(node.child2, contained);
+            }
+        }
+    }
+
+    struct Node {
+        Point<N> min {0, 0, 0};
+        Point<N> max {0, 0, 0};
+
+        // doubles as the free list link for unused nodes
+        int parent = NULL_NODE;
+        int child1 = NULL_NODE;
+        int child2 = NULL_NODE;
+
+        // 0 for leaves, -1 for free nodes
+        int height = 0;
+
+        // what the leaf holds, a MeshId when set is MESH_SET
+        uint32_t set = MESH_SET;
+        uint32_t index = 0;
+
+        bool leaf() const {
+            return child1 == NULL_NODE;
+        }
+    };
+
+    std::vector<Mesh<N>> meshes;
+    std::size_t triangle_count = 0;
+    uint64_t changes = 0;
+
+    std::vector<InstanceSet<N>> sets;
+    std::unordered_map<const Geometry<N>*, uint32_t> set_of;
+    std::size_t instance_total = 0;
+
+    std::vector<Node> nodes;
+    std::vector<int> leaves; // leaf node of each mesh
+    std::vector<std::vector<int>> instance_leaves; // leaf node of each instance, by set
+    int root = NULL_NODE;
+    int free_list = NULL_NODE;
+
+    mutable std::vector<std::pair<int, bool>> stack;
+
+    // leaf's contents now have bounds b
+    void refit(int leaf, const Bounds<N>& b) {
+        const Node& n = nodes[leaf];
+        const bool inside = n.min.x <= b.min.x && n.min.y <= b.min.y && n.min.z <= b.min.z
+            && b.max.x <= n.max.x && b.max.y <= n.max.y && b.max.z <= n.max.z;
+        if (inside) {
+            return;
+        }
+
+        remove_leaf(leaf);
+        fatten(leaf, b);
+        insert_leaf(leaf);
+    }
+
+    void fatten(int leaf, const Bounds<N>& b) {
+        nodes[leaf].min = Point<N>(b.min.x - AABB_MARGIN, b.min.y - AABB_MARGIN, b.min.z - AABB_MARGIN);
+        nodes[leaf].max = Point<N>(b.max.x + AABB_MARGIN, b.max.y + AABB_MARGIN, b.max.z + AABB_MARGIN);
+    }
+
+    int allocate_node() {
+        if (free_list == NULL_NODE) {
+            nodes.emplace_back();
+            return static_cast<int>(nodes.size() - 1);
+        }
+        const int index = free_list;
+        free_list = nodes[index].parent;
+        nodes[index] = Node{};
+        return index;
+    }
+
+    void free_node(int index) {
+        nodes[index].parent = free_list;
+        nodes[index].height = -1;
+        free_list = index;
+    }
+
+    static N perimeter(const Point<N>& min, const Point<N>& max) {
+        return 2 * ((max.x - min.x) + (max.y - min.y) + (max.z - min.z));
+    }
+
+    static std::pair<Point<N>, Point<N>> combine(const Node& a, const Node& b) {
+        return {
+            Point<N>(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z)),
+            Point<N>(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z))
+        };
+    }
+
+    void refit_node(int index) {
+        Node& n = nodes[index];
+        const auto [min, max] = combine(nodes[n.child1], nodes[n.child2]);
+        n.min = min;
+        n.max = max;
+        n.height = 1 + std::max(nodes[n.child1].height, nodes[n.child2].height);
+    }
+
+    // cost of putting leaf somewhere under index, using the surface area heuristic (perimeter)
+    N descend_cost(int leaf, int index) const {
+        const auto [min, max] = combine(nodes[leaf], nodes[index]);
+        if (nodes[index].leaf()) {
+            return perimeter(min, max);
+        }
+        return perimeter(min, max) - perimeter(nodes[index].min, nodes[index].max);
+    }
+
+    void insert_leaf(int leaf) {
+        if (root == NULL_NODE) {
+            root = leaf;
+            nodes[root].parent = NULL_NODE;
+            return;
+        }
+
+        // find the best sibling
+        int index = root;
+        while (!nodes[index].leaf()) {
+            const Node& n = nodes[index];
+            const N area = perimeter(n.min, n.max);
+            const auto [min, max] = combine(n, nodes[leaf]);
+            const N combined = perimeter(min, max);
+
+            // cost of a new parent for this node and the leaf, and the cost pushed down to children
+            const N cost = 2 * combined;
+            const N inheritance = 2 * (combined - area);
+
+            const N cost1 = descend_cost(leaf, n.child1) + inheritance;
+            const N cost2 = descend_cost(leaf, n.child2) + inheritance;
+            if (cost < cost1 && cost < cost2) {
+                break;
+            }
+            index = cost1 < cost2 ? n.child1 : n.child2;
+        }
+        const int sibling = index;
+
+        // new parent for the leaf and its sibling
+        const int old_parent = nodes[sibling].parent;
+        const int new_parent = allocate_node();
+        nodes[new_parent].parent = old_parent;
+        nodes[new_parent].child1 = sibling;
+        nodes[new_parent].child2 = leaf;
+        nodes[sibling].parent = new_parent;
+        nodes[leaf].parent = new_parent;
+        refit_node(new_parent);
+
+        if (old_parent == NULL_NODE) {
+            root = new_parent;
+        } else if (nodes[old_parent].child1 == sibling) {
+            nodes[old_parent].child1 = new_parent;
+        } else {
+            nodes[old_parent].child2 = new_parent;
+        }
+
+        refit_upwards(nodes[leaf].parent);
+    }
+
+    void remove_leaf(int leaf) {
+        if (leaf == root) {
+            root = NULL_NODE;
+            return;
+        }
+
+        const int parent = nodes[leaf].parent;
+        const int grandparent = nodes[parent].parent;
+        const int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+        // the sibling takes the parent's place
+        if (grandparent == NULL_NODE) {
+            root = sibling;
+            nodes[sibling].parent = NULL_NODE;
+            free_node(parent);
+            return;
+        }
+        if (nodes[grandparent].child1 == parent) {
+            nodes[grandparent].child1 = sibling;
+        } else {
+            nodes[grandparent].child2 = sibling;
+        }
+        nodes[sibling].parent = grandparent;
+        free_node(parent);
+
+        refit_upwards(grandparent);
+    }
+
+    void refit_upwards(int index) {
+        while (index != NULL_NODE) {
+            index = balance(index);
+            refit_node(index);
+            index = nodes[index].parent;
+        }
+    }
+
+    void replace_child(int parent, int old_child, int new_child) {
+        if (parent == NULL_NODE) {
+            root = new_child;
+        } else if (nodes[parent].child1 == old_child) {
+            nodes[parent].child1 = new_child;
+        } else {
+            nodes[parent].child2 = new_child;
+        }
+    }
+
+    // AVL style rotation when a's children differ in height by more than one, returns the
+    // node now sitting where a was
+    int balance(int a) {
+        if (nodes[a].leaf() || nodes[a].height < 2) {
+            return a;
+        }
+
+        const int b = nodes[a].child1;
+        const int c = nodes[a].child2;
+        const int diff = nodes[c].height - nodes[b].height;
+
+        if (diff > 1) {
+            // rotate c up
+            const int f = nodes[c].child1;
+            const int g = nodes[c].child2;
+            nodes[c].child1 = a;
+            nodes[c].parent = nodes[a].parent;
+            nodes[a].parent = c;
+            replace_child(nodes[c].parent, a, c);
+
+            // the taller of c's children stays with c
+            const int keep = nodes[f].height > nodes[g].height ? f : g;
+            const int move = keep == f ? g : f;
+            nodes[c].child2 = keep;
+            nodes[a].child2 = move;
+            nodes[move].parent = a;
+            refit_node(a);
+            refit_node(c);
+            return c;
+        }
+
+        if (diff < -1) {
+            // rotate b up
+            const int d = nodes[b].child1;
+            const int e = nodes[b].child2;
+            nodes[b].child1 = a;
+            nodes[b].parent = nodes[a].parent;
+            nodes[a].parent = b;
+            replace_child(nodes[b].parent, a, b);
+
+            const int keep = nodes[d].height > nodes[e].height ? d : e;
+            const int move = keep == d ? e : d;
+            nodes[b].child2 = keep;
+            nodes[a].child1 = move;
+            nodes[move].parent = a;
+            refit_node(a);
+            refit_node(b);
+            return b;
+        }
+
+        return a;
+    }
+};
@@ -0,0 +1,357 @@
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <optional>
+#include <memory>
+#include <future>
+#include <filesystem>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include "Point.hpp"
+#include "Triangle.hpp"
+#include "Scene.hpp"
+#include "MeshCache.hpp"
+#include "Lod.hpp"
+
+// one row of models.csv
+struct ModelPlacement {
+    Point<double> origin;
+    double scale;
+    std::string file;
+};
+
+// reads a file in fixed size chunks and hands each complete line to fn, so large model files are
+// parsed while they stream in instead of being read into memory whole
+template <typename F>
+bool for_each_line(const std::filesystem::path& path, F&& fn) {
+    constexpr std::size_t CHUNK_SIZE = 1 << 16;
+
+    std::ifstream in (path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    std::vector<char> chunk (CHUNK_SIZE);
+    std::string carry; // a line split across two chunks
+    while (in) {
+        in.read(chunk.data(), chunk.size());
+        const std::size_t n = static_cast<std::size_t>(in.gcount());
+
+        std::size_t start = 0;
+        for (std::size_t i = 0; i < n; i++) {
+            if (chunk[i] != '\n') {
+                continue;
+            }
+            std::string_view line (chunk.data() + start, i - start);
+            if (!carry.empty()) {
+                carry.append(line);
+                line = carry;
+            }
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            fn(line);
+            carry.clear();
+            start = i + 1;
+        }
+        carry.append(chunk.data() + start, n - start);
+    }
+
+    if (!carry.empty()) {
+        std::string_view line = carry;
+        if (line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        fn(line);
+    }
+    return true;
+}
+
+// split line on any of the characters in seps, skipping empty fields
+inline std::vector<std::string_view> split_fields(std::string_view line, std::string_view seps) {
+    std::vector<std::string_view> fields;
+    std::size_t start = 0;
+    while (start <= line.size()) {
+        const std::size_t end = std::min(line.find_first_of(seps, start), line.size());
+        if (end > start) {
+            fields.push_back(line.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+    return fields;
+}
+
+inline bool parse_number(std::string_view field, double& out) {
+    while (!field.empty() && field.front() == ' ') {
+        field.remove_prefix(1);
+    }
+    while (!field.empty() && field.back() == ' ') {
+        field.remove_suffix(1);
+    }
+    const auto [ptr, ec] = std::from_chars(field.data(), field.data() + field.size(), out);
+    return ec == std::errc() && ptr == field.data() + field.size();
+}
+
+// csv triangle format, one triangle per row: AX,AY,AZ,BX,BY,BZ,CX,CY,CZ. rows that aren't nine
+// numbers (like a header) are skipped.
+inline std::optional<ModelData> load_csv_model(const std::filesystem::path& path) {
+    std::vector<Triangle<double>> tris;
+    const bool opened = for_each_line(path, [&](std::string_view line) {
+        const std::vector<std::string_view> fields = split_fields(line, ",");
+        if (fields.size() != 9) {
+            return;
+        }
+        double v[9];
+        for (int i = 0; i < 9; i++) {
+            if (!parse_number(fields[i], v[i])) {
+                return;
+            }
+        }
+        tris.emplace_back(Point<double>(v[0], v[1], v[2]), Point<double>(v[3], v[4], v[5]), Point<double>(v[6], v[7], v[8]));
+    });
+    if (!opened) {
+        std::cerr << "Couldn't open model " << path << std::endl;
+        return std::nullopt;
+    }
+
+    IndexedTriangles<double> indexed = index_triangles(tris);
+    return ModelData{VertexArray<double>(indexed.verts), std::move(indexed.faces)};
+}
+
+// wavefront obj, only v and f records are used. polygons are split into triangle fans and
+// negative (relative) indices are supported.
+inline std::optional<ModelData> load_obj_model(const std::filesystem::path& path) {
+    ModelData model;
+    bool valid = true;
+    const bool opened = for_each_line(path, [&](std::string_view line) {
+        const std::vector<std::string_view> fields = split_fields(line, " \t");
+        if (fields.empty()) {
+            return;
+        }
+
+        if (fields[0] == "v" && fields.size() >= 4) {
+            double x, y, z;
+            if (parse_number(fields[1], x) && parse_number(fields[2], y) && parse_number(fields[3], z)) {
+                model.verts.push_back(Point<double>(x, y, z));
+            } else {
+                valid = false;
+            }
+        } else if (fields[0] == "f" && fields.size() >= 4) {
+            std::vector<uint32_t> corners;
+            for (std::size_t i = 1; i < fields.size(); i++) {
+                // "v", "v/vt", "v//vn" or "v/vt/vn", only v matters
+                const std::string_view v = fields[i].substr(0, fields[i].find('/'));
+                long index = 0;
+                const auto [ptr, ec] = std::from_chars(v.data(), v.data() + v.size(), index);
+                if (ec != std::errc() || index == 0) {
+                    valid = false;
+                    return;
+                }
+                const long resolved = index > 0 ? index - 1 : static_cast<long>(model.verts.size()) + index;
+                if (resolved < 0) {
+                    valid = false;
+                    return;
+                }
+                corners.push_back(static_cast<uint32_t>(resolved));
+            }
+            for (std::size_t i = 1; i + 1 < corners.size(); i++) {
+                model.faces.push_back(Face{corners[0], corners[i], corners[i + 1]});
+            }
+        }
+    });
+
+    if (!opened) {
+        std::cerr << "Couldn't open model " << path << std::endl;
+        return std::nullopt;
+    }
+    for (const Face& f : model.faces) {
+        if (f.a >= model.verts.size() || f.b >= model.verts.size() || f.c >= model.verts.size()) {
+            valid = false;
+        }
+    }
+    if (!valid) {
+        std::cerr << "Malformed model " << path << std::endl;
+        return std::nullopt;
+    }
+    return model;
+}
+
+inline std::optional<ModelData> parse_model(const std::filesystem::path& path) {
+    if (path.extension() == ".obj") {
+        return load_obj_model(path);
+    }
+    return load_csv_model(path);
+}
+
+// the model's geometry and levels of detail: the binary cache when it's up to date, otherwise
+// parse the source, simplify it and write a fresh cache
+inline GeometryPtr<double> load_model(const std::filesystem::path& path) {
+    GeometryPtr<double> geometry = read_mesh_cache(path);
+    if (geometry) {
+        return geometry;
+    }
+
+    std::optional<ModelData> model = parse_model(path);
+    if (!model) {
+        return nullptr;
+    }
+    geometry = build_lods(Geometry<double>(std::move(model->verts), std::move(model->faces)));
+    if (!write_mesh_cache(path, *geometry)) {
+        std::cerr << "Couldn't write mesh cache for " << path << std::endl;
+    }
+    return geometry;
+}
+
+// g and its levels of detail in another number type. the derived parts carry over as they are,
+// nothing is rebuilt or simplified again.
+template <Numeric N>
+GeometryPtr<N> convert_geometry(const Geometry<double>& g) {
+    const auto convert = [](const Geometry<double>& level) {
+        VertexArray<N> verts;
+        verts.reserve(level.verts.size());
+        for (std::size_t i = 0; i < level.verts.size(); i++) {
+            verts.push_back(static_cast<Point<N>>(level.verts[i]));
+        }
+        std::vector<Point<N>> normals;
+        normals.reserve(level.normals.size());
+        for (const Point<double>& n : level.normals) {
+            normals.push_back(static_cast<Point<N>>(n));
+        }
+        return Geometry<N>(std::move(verts), level.faces, level.edges, level.edge_faces, std::move(normals));
+    };
+
+    Geometry<N> converted = convert(g);
+    for (const Geometry<double>::Lod& lod : g.lods) {
+        converted.lods.push_back({std::make_shared<const Geometry<N>>(convert(*lod.geometry)), static_cast<N>(lod.error)});
+    }
+    return std::make_shared<const Geometry<N>>(std::move(converted));
+}
+
+// model file -> geometry with its levels of detail, nullptr if it didn't load
+template <Numeric N>
+GeometryPtr<N> load_geometry(const std::string& file) {
+    GeometryPtr<double> geometry = load_model(file);
+    if constexpr (std::is_same_v<N, double>) {
+        return geometry;
+    } else {
+        return geometry ? convert_geometry<N>(*geometry) : nullptr;
+    }
+}
+
+// rows of models.csv, ORIGIN_X,ORIGIN_Y,ORIGIN_Z,SCALE,MODEL_FILE with the header row skipped.
+// MODEL_FILE is resolved relative to models.csv.
+inline std::optional<std::vector<ModelPlacement>> load_placements(const std::filesystem::path& path) {
+    std::vector<ModelPlacement> placements;
+    const std::filesystem::path dir = path.parent_path();
+    const bool opened = for_each_line(path, [&](std::string_view line) {
+        const std::vector<std::string_view> fields = split_fields(line, ",");
+        if (fields.size() != 5) {
+            return;
+        }
+        double v[4];
+        for (int i = 0; i < 4; i++) {
+            if (!parse_number(fields[i], v[i])) {
+                return;
+            }
+        }
+        std::string_view file = fields[4];
+        while (!file.empty() && file.front() == ' ') {
+            file.remove_prefix(1);
+        }
+        placements.push_back(ModelPlacement{Point<double>(v[0], v[1], v[2]), v[3], (dir / file).lexically_normal().string()});
+    });
+    if (!opened) {
+        std::cerr << "Couldn't open " << path << std::endl;
+        return std::nullopt;
+    }
+    return placements;
+}
+
+// loads the models listed in models.csv in the background. every distinct MODEL_FILE is loaded
+// once on its own thread, from its mesh cache or else parsed and simplified into its levels of
+// detail, and every row naming it becomes an instance of the resulting Geometry.
+// poll() adds the instances of whatever has finished to a Scene without blocking, so the caller
+// can keep rendering while large files load.
+template <Numeric N>
+class SceneLoader {
+public:
+    explicit SceneLoader(const std::filesystem::path& models_csv) {
+        const std::optional<std::vector<ModelPlacement>> placements = load_placements(models_csv);
+        if (!placements) {
+            return;
+        }
+
+        std::map<std::string, std::size_t> by_file;
+        for (const ModelPlacement& p : placements.value()) {
+            const auto [it, inserted] = by_file.try_emplace(p.file, pending.size());
+            if (inserted) {
+                Pending job;
+                job.file = p.file;
+                job.geometry = std::async(std::launch::async, [file = p.file] {
+                    return load_geometry<N>(file);
+                });
+                pending.push_back(std::move(job));
+            }
+            pending[it->second].placements.push_back(p);
+        }
+    }
+
+    // move finished models into scene, true once nothing is left to load
+    bool poll(Scene<N>& scene) {
+        for (Pending& job : pending) {
+            if (!job.done && job.geometry.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                add_instances(job, scene);
+            }
+        }
+        return finished();
+    }
+
+    // block until every model is in scene
+    void wait(Scene<N>& scene) {
+        for (Pending& job : pending) {
+            if (!job.done) {
+                job.geometry.wait();
+                add_instances(job, scene);
+            }
+        }
+    }
+
+    bool finished() const {
+        for (const Pending& job : pending) {
+            if (!job.done) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    struct Pending {
+        std::string file;
+        std::future<GeometryPtr<N>> geometry;
+        std::vector<ModelPlacement> placements;
+        bool done = false;
+    };
+
+    std::vector<Pending> pending;
+
+    void add_instances(Pending& job, Scene<N>& scene) {
+        job.done = true;
+        // one geometry for every row naming this file
+        const GeometryPtr<N> geometry = job.geometry.get();
+        if (!geometry) {
+            return;
+        }
+        for (const ModelPlacement& p : job.placements) {
+            Transform<N> t;
+            t.position = static_cast<Point<N>>(p.origin);
+            t.scale = static_cast<N>(p.scale);
+            scene.add_instance(geometry, t, 255, 255, 255);
+        }
+    }
+};
@@ -0,0 +1,133 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <cstdint>
+#include <SDL.h>
+#include "RenderBackend.hpp"
+#include "LineBatch.hpp"
+#include "Framebuffer.hpp"
+
+// an SDL window and accelerated renderer. owns SDL's video subsystem for its lifetime.
+class SdlBackend : public RenderBackend {
+public:
+    // nullptr (after reporting why) if SDL, the window or the renderer can't be set up. with vsync
+    // present() blocks until the display's next refresh.
+    static std::unique_ptr<SdlBackend> create(const std::string& title, int width, int height, bool vsync = false) {
+        // initialize SDL
+        if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+            std::cerr << "SDL initialization failed: " << SDL_GetError() << std::endl;
+            return nullptr;
+        }
+
+        // create a window
+        SDL_Window* window = SDL_CreateWindow(title.c_str(), SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, width, height, SDL_WINDOW_SHOWN);
+        if (!window) {
+            std::cerr << "Window creation failed: " << SDL_GetError() << std::endl;
+            SDL_Quit();
+            return nullptr;
+        }
+
+        // create a renderer for the window
+        SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | (vsync ? SDL_RENDERER_PRESENTVSYNC : 0));
+        if (!renderer) {
+            std::cerr << "Renderer creation failed: " << SDL_GetError() << std::endl;
+            SDL_DestroyWindow(window);
+            SDL_Quit();
+            return nullptr;
+        }
+
+        return std::unique_ptr<SdlBackend>(new SdlBackend(window, renderer));
+    }
+
+    ~SdlBackend() override {
+        if (texture) {
+            SDL_DestroyTexture(texture);
+        }
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+    }
+
+    SdlBackend(const SdlBackend&) = delete;
+    SdlBackend& operator=(const SdlBackend&) = delete;
+
+    void clear(int red, int green, int blue) override {
+        SDL_SetRenderDrawColor(renderer, red, green, blue, 255);
+        SDL_RenderClear(renderer);
+    }
+
+    // each colour group as one SDL_RenderGeometry call, every segment expanded into a one pixel
+    // wide quad
+    int draw_lines(const LineBatch& batch) override {
+        int draw_calls = 0;
+        for (const LineGroup& g : batch.line_groups()) {
+            if (g.size() == 0) {
+                continue;
+            }
+
+            verts.clear();
+            indices.clear();
+            const SDL_Color colour {static_cast<Uint8>(g.red), static_cast<Uint8>(g.green), static_cast<Uint8>(g.blue), 255};
+            for (std::size_t i = 0; i < g.points.size(); i += 4) {
+                // pixel centres
+                const float x1 = g.points[i] + 0.5f;
+                const float y1 = g.points[i+1] + 0.5f;
+                const float x2 = g.points[i+2] + 0.5f;
+                const float y2 = g.points[i+3] + 0.5f;
+
+                // half pixel offsets across (nx, ny) and along (dx, dy) the segment
+                const float len = std::hypot(x2 - x1, y2 - y1);
+                const float dx = len > 0.0f ? 0.5f * (x2 - x1) / len : 0.5f;
+                const float dy = len > 0.0f ? 0.5f * (y2 - y1) / len : 0.0f;
+                const float nx = -dy;
+                const float ny = dx;
+
+                const int base = static_cast<int>(verts.size());
+                verts.push_back(SDL_Vertex{{x1 - dx + nx, y1 - dy + ny}, colour, {0, 0}});
+                verts.push_back(SDL_Vertex{{x1 - dx - nx, y1 - dy - ny}, colour, {0, 0}});
+                verts.push_back(SDL_Vertex{{x2 + dx - nx, y2 + dy - ny}, colour, {0, 0}});
+                verts.push_back(SDL_Vertex{{x2 + dx + nx, y2 + dy + ny}, colour, {0, 0}});
+                indices.insert(indices.end(), {base, base + 1, base + 2, base, base + 2, base + 3});
+            }
+
+            SDL_RenderGeometry(renderer, nullptr, verts.data(), static_cast<int>(verts.size()), indices.data(), static_cast<int>(indices.size()));
+            draw_calls += 1;
+        }
+        return draw_calls;
+    }
+
+    // uploaded into a streaming texture that is created on first use
+    void draw_framebuffer(const Framebuffer& frame) override {
+        if (!texture) {
+            texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, frame.width, frame.height);
+            if (!texture) {
+                std::cerr << "Texture creation failed: " << SDL_GetError() << std::endl;
+                return;
+            }
+        }
+        SDL_UpdateTexture(texture, nullptr, frame.pixels.data(), frame.stride * static_cast<int>(sizeof(uint32_t)));
+        SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+    }
+
+    void present() override {
+        SDL_RenderPresent(renderer);
+    }
+
+    void set_title(const std::string& title) override {
+        SDL_SetWindowTitle(window, title.c_str());
+    }
+
+private:
+    SDL_Window* window;
+    SDL_Renderer* renderer;
+    SDL_Texture* texture = nullptr;
+
+    // vertex/index storage reused by every draw_lines
+    std::vector<SDL_Vertex> verts;
+    std::vector<int> indices;
+
+    SdlBackend(SDL_Window* window, SDL_Renderer* renderer) : window{window}, renderer{renderer} {}
+};
@@ -0,0 +1,686 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "Point.hpp"
+#include "Matrix.hpp"
+#include "VertexArray.hpp"
+#include "ClipSpace.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ENGINE_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define ENGINE_SIMD_X86 0
+#endif
+
+// batch vertex kernels over VertexArray/ScreenArray.
+// double and float arrays are dispatched at runtime to AVX (4 or 8 lanes) or SSE2 (2 or 4 lanes)
+// when the cpu supports it, every other Numeric runs the scalar versions.
+
+enum class SimdLevel {
+    SCALAR,
+    SSE2,
+    AVX
+};
+
+inline SimdLevel detect_simd_level() {
+#if ENGINE_SIMD_X86
+    static const SimdLevel level = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx")) {
+            return SimdLevel::AVX;
+        } else if (__builtin_cpu_supports("sse2")) {
+            return SimdLevel::SSE2;
+        }
+        return SimdLevel::SCALAR;
+    }();
+    return level;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+inline const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX:
+            return "avx";
+        case SimdLevel::SSE2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
+
+namespace scalar {
+
+template <Numeric N>
+void translate_vertices(VertexArray<N>& v, const Point<N>& t) {
+    for (std::size_t i = 0; i < v.size(); i++) {
+        v.x[i] += t.x;
+        v.y[i] += t.y;
+        v.z[i] += t.z;
+    }
+}
+
+template <Numeric N>
+void scale_vertices(VertexArray<N>& v, const Point<N>& origin, N s) {
+    for (std::size_t i = 0; i < v.size(); i++) {
+        v.x[i] = (v.x[i] - origin.x) * s + origin.x;
+        v.y[i] = (v.y[i] - origin.y) * s + origin.y;
+        v.z[i] = (v.z[i] - origin.z) * s + origin.z;
+    }
+}
+
+// in place affine transform, the bottom row of m is ignored
+template <Numeric N>
+void transform_vertices(VertexArray<N>& v, const Mat4<N>& m) {
+    for (std::size_t i = 0; i < v.size(); i++) {
+        const N x = v.x[i];
+        const N y = v.y[i];
+        const N z = v.z[i];
+        v.x[i] = m.m[0][0]*x + m.m[0][1]*y + m.m[0][2]*z + m.m[0][3];
+        v.y[i] = m.m[1][0]*x + m.m[1][1]*y + m.m[1][2]*z + m.m[1][3];
+        v.z[i] = m.m[2][0]*x + m.m[2][1]*y + m.m[2][2]*z + m.m[2][3];
+    }
+}
+
+// window coordinates of vertices inside the guard band fit an int with room to spare, further
+// out (or behind the eye, or with w near 0) they are garbage the outcodes flag. floating point
+// ones are clamped to a little past the guard band first so converting garbage is never
+// undefined, other Numerics (Fixed saturates) always convert.
+template <Numeric N>
+int window_coordinate(N v, double half) {
+    if constexpr (std::is_floating_point_v<N>) {
+        const N limit = static_cast<N>((GUARD_BAND + 2) * half);
+        return static_cast<int>(v > -limit ? (v < limit ? v : limit) : -limit);
+    } else {
+        return static_cast<int>(v);
+    }
+}
+
+// model -> clip -> window in one pass: clip_outcode of each clip space position, then the
+// perspective divide and viewport map (project_point + scale_point_to_win with one reciprocal per
+// vertex). clip space positions are never stored, a vertex that needs clipping before the divide
+// is transformed again by whoever clips it. codes needs room for simd_padded<N>(v.size()) outcodes.
+template <Numeric N>
+void transform_to_window(const VertexArray<N>& v, const Mat4<N>& m, int width, int height, uint8_t* codes, ScreenArray<N>& out) {
+    const double hw = width / 2.0;
+    const double hh = height / 2.0;
+
+    out.resize(v.size());
+    for (std::size_t i = 0; i < v.size(); i++) {
+        const N x = v.x[i];
+        const N y = v.y[i];
+        const N z = v.z[i];
+        const N cx = m.m[0][0]*x + m.m[0][1]*y + m.m[0][2]*z + m.m[0][3];
+        const N cy = m.m[1][0]*x + m.m[1][1]*y + m.m[1][2]*z + m.m[1][3];
+        const N cz = m.m[2][0]*x + m.m[2][1]*y + m.m[2][2]*z + m.m[2][3];
+        const N cw = m.m[3][0]*x + m.m[3][1]*y + m.m[3][2]*z + m.m[3][3];
+        codes[i] = clip_outcode(cx, cy, cz, cw);
+
+        const N inv_w = 1 / cw;
+        const N nx = cx * inv_w;
+        const N ny = cy * inv_w;
+        out.x[i] = window_coordinate(hw * nx + hw, hw);
+        out.y[i] = window_coordinate(height - (hh * ny + hh), hh);
+        out.z[i] = cz * inv_w;
+    }
+}
+
+} // namespace scalar
+
+#if ENGINE_SIMD_X86
+namespace sse2 {
+
+__attribute__((target("sse2")))
+inline void translate_vertices(VertexArray<double>& v, const Point<double>& t) {
+    const __m128d tx = _mm_set1_pd(t.x);
+    const __m128d ty = _mm_set1_pd(t.y);
+    const __m128d tz = _mm_set1_pd(t.z);
+    for (std::size_t i = 0; i < v.padded_size(); i += 2) {
+        _mm_store_pd(&v.x[i], _mm_add_pd(_mm_load_pd(&v.x[i]), tx));
+        _mm_store_pd(&v.y[i], _mm_add_pd(_mm_load_pd(&v.y[i]), ty));
+        _mm_store_pd(&v.z[i], _mm_add_pd(_mm_load_pd(&v.z[i]), tz));
+    }
+}
+
+__attribute__((target("sse2")))
+inline void scale_vertices(VertexArray<double>& v, const Point<double>& origin, double s) {
+    const __m128d ox = _mm_set1_pd(origin.x);
+    const __m128d oy = _mm_set1_pd(origin.y);
+    const __m128d oz = _mm_set1_pd(origin.z);
+    const __m128d vs = _mm_set1_pd(s);
+    for (std::size_t i = 0; i < v.padded_size(); i += 2) {
+        _mm_store_pd(&v.x[i], _mm_add_pd(_mm_mul_pd(_mm_sub_pd(_mm_load_pd(&v.x[i]), ox), vs), ox));
+        _mm_store_pd(&v.y[i], _mm_add_pd(_mm_mul_pd(_mm_sub_pd(_mm_load_pd(&v.y[i]), oy), vs), oy));
+        _mm_store_pd(&v.z[i], _mm_add_pd(_mm_mul_pd(_mm_sub_pd(_mm_load_pd(&v.z[i]), oz), vs), oz));
+    }
+}
+
+// m broadcast into registers once per batch, the output arrays could alias m so the
+// compiler can't hoist these loads out of the loop by itself
+struct Mat4x2 {
+    __m128d m[4][4];
+
+    __attribute__((target("sse2")))
+    Mat4x2(const Mat4<double>& mat) {
+        for (int r = 0; r < 4; r++) {
+            for (int c = 0; c < 4; c++) {
+                m[r][c] = _mm_set1_pd(mat.m[r][c]);
+            }
+        }
+    }
+
+    // one row of m applied to 2 vertices
+    __attribute__((target("sse2")))
+    __m128d row(int r, __m128d x, __m128d y, __m128d z) const {
+        __m128d acc = _mm_mul_pd(m[r][0], x);
+        acc = _mm_add_pd(acc, _mm_mul_pd(m[r][1], y));
+        acc = _mm_add_pd(acc, _mm_mul_pd(m[r][2], z));
+        return _mm_add_pd(acc, m[r][3]);
+    }
+};
+
+__attribute__((target("sse2")))
+inline void transform_vertices(VertexArray<double>& v, const Mat4<double>& m) {
+    const Mat4x2 mm (m);
+    for (std::size_t i = 0; i < v.padded_size(); i += 2) {
+        const __m128d x = _mm_load_pd(&v.x[i]);
+        const __m128d y = _mm_load_pd(&v.y[i]);
+        const __m128d z = _mm_load_pd(&v.z[i]);
+        _mm_store_pd(&v.x[i], mm.row(0, x, y, z));
+        _mm_store_pd(&v.y[i], mm.row(1, x, y, z));
+        _mm_store_pd(&v.z[i], mm.row(2, x, y, z));
+    }
+}
+
+// clip_outcode of 2 vertices, in the low 2 bytes. each test's mask selects its code's value and
+// the codes are distinct bits, so adding them up ors them.
+__attribute__((target("sse2")))
+inline __m128i outcodes(__m128d x, __m128d y, __m128d z, __m128d w) {
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d nw = _mm_sub_pd(zero, w);
+    const __m128d g = _mm_mul_pd(_mm_set1_pd(GUARD_BAND), w);
+    const __m128d ng = _mm_sub_pd(zero, g);
+
+    const __m128d left = _mm_cmplt_pd(x, nw);
+    const __m128d right = _mm_andnot_pd(left, _mm_cmpgt_pd(x, w));
+    const __m128d bottom = _mm_cmplt_pd(y, nw);
+    const __m128d top = _mm_andnot_pd(bottom, _mm_cmpgt_pd(y, w));
+    const __m128d behind = _mm_cmplt_pd(z, zero);
+    const __m128d beyond = _mm_andnot_pd(behind, _mm_cmpgt_pd(z, w));
+    const __m128d guard = _mm_or_pd(_mm_or_pd(_mm_cmplt_pd(x, ng), _mm_cmpgt_pd(x, g)), _mm_or_pd(_mm_cmplt_pd(y, ng), _mm_cmpgt_pd(y, g)));
+
+    __m128d code = _mm_and_pd(left, _mm_set1_pd(CLIP_LEFT));
+    code = _mm_add_pd(code, _mm_and_pd(right, _mm_set1_pd(CLIP_RIGHT)));
+    code = _mm_add_pd(code, _mm_and_pd(bottom, _mm_set1_pd(CLIP_BOTTOM)));
+    code = _mm_add_pd(code, _mm_and_pd(top, _mm_set1_pd(CLIP_TOP)));
+    code = _mm_add_pd(code, _mm_and_pd(behind, _mm_set1_pd(CLIP_NEAR)));
+    code = _mm_add_pd(code, _mm_and_pd(beyond, _mm_set1_pd(CLIP_FAR)));
+    code = _mm_add_pd(code, _mm_and_pd(guard, _mm_set1_pd(CLIP_GUARD)));
+    const __m128i c32 = _mm_cvttpd_epi32(code);
+    return _mm_packus_epi16(_mm_packs_epi32(c32, c32), c32);
+}
+
+__attribute__((target("sse2")))
+inline void transform_to_window(const VertexArray<double>& v, const Mat4<double>& m, int width, int height, uint8_t* codes, ScreenArray<double>& out) {
+    const Mat4x2 mm (m);
+    const __m128d hw = _mm_set1_pd(width / 2.0);
+    const __m128d hh = _mm_set1_pd(height / 2.0);
+    const __m128d h = _mm_set1_pd(height);
+
+    out.resize(v.size());
+    for (std::size_t i = 0; i < v.padded_size(); i += 2) {
+        const __m128d x = _mm_load_pd(&v.x[i]);
+        const __m128d y = _mm_load_pd(&v.y[i]);
+        const __m128d z = _mm_load_pd(&v.z[i]);
+        const __m128d cx = mm.row(0, x, y, z);
+        const __m128d cy = mm.row(1, x, y, z);
+        const __m128d cz = mm.row(2, x, y, z);
+        const __m128d cw = mm.row(3, x, y, z);
+        const int c = _mm_cvtsi128_si32(outcodes(cx, cy, cz, cw));
+        std::memcpy(&codes[i], &c, 2);
+
+        const __m128d inv_w = _mm_div_pd(_mm_set1_pd(1.0), cw);
+        const __m128d sx = _mm_add_pd(_mm_mul_pd(hw, _mm_mul_pd(cx, inv_w)), hw);
+        const __m128d sy = _mm_sub_pd(h, _mm_add_pd(_mm_mul_pd(hh, _mm_mul_pd(cy, inv_w)), hh));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(&out.x[i]), _mm_cvttpd_epi32(sx));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(&out.y[i]), _mm_cvttpd_epi32(sy));
+        _mm_store_pd(&out.z[i], _mm_mul_pd(cz, inv_w));
+    }
+}
+
+// float versions, twice the lanes of the double ones
+
+__attribute__((target("sse2")))
+inline void translate_vertices(VertexArray<float>& v, const Point<float>& t) {
+    const __m128 tx = _mm_set1_ps(t.x);
+    const __m128 ty = _mm_set1_ps(t.y);
+    const __m128 tz = _mm_set1_ps(t.z);
+    for (std::size_t i = 0; i < v.padded_size(); i += 4) {
+        _mm_store_ps(&v.x[i], _mm_add_ps(_mm_load_ps(&v.x[i]), tx));
+        _mm_store_ps(&v.y[i], _mm_add_ps(_mm_load_ps(&v.y[i]), ty));
+        _mm_store_ps(&v.z[i], _mm_add_ps(_mm_load_ps(&v.z[i]), tz));
+    }
+}
+
+__attribute__((target("sse2")))
+inline void scale_vertices(VertexArray<float>& v, const Point<float>& origin, float s) {
+    const __m128 ox = _mm_set1_ps(origin.x);
+    const __m128 oy = _mm_set1_ps(origin.y);
+    const __m128 oz = _mm_set1_ps(origin.z);
+    const __m128 vs = _mm_set1_ps(s);
+    for (std::size_t i = 0; i < v.padded_size(); i += 4) {
+        _mm_store_ps(&v.x[i], _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(&v.x[i]), ox), vs), ox));
+        _mm_store_ps(&v.y[i], _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(&v.y[i]), oy), vs), oy));
+        _mm_store_ps(&v.z[i], _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(&v.z[i]), oz), vs), oz));
+    }
+}
+
+struct Mat4x4f {
+    __m128 m[4][4];
+
+    __attribute__((target("sse2")))
+    Mat4x4f(const Mat4<float>& mat) {
+        for (int r = 0; r < 4; r++) {
+            for (int c = 0; c < 4; c++) {
+                m[r][c] = _mm_set1_ps(mat.m[r][c]);
+            }
+        }
+    }
+
+    // one row of m applied to 4 vertices
+    __attribute__((target("sse2")))
+    __m128 row(int r, __m128 x, __m128 y, __m128 z) const {
+        __m128 acc = _mm_mul_ps(m[r][0], x);
+        acc = _mm_add_ps(acc, _mm_mul_ps(m[r][1], y));
+        acc = _mm_add_ps(acc, _mm_mul_ps(m[r][2], z));
+        return _mm_add_ps(acc, m[r][3]);
+    }
+};
+
+__attribute__((target("sse2")))
+inline void transform_vertices(VertexArray<float>& v, const Mat4<float>& m) {
+    const Mat4x4f mm (m);
+    for (std::size_t i = 0; i < v.padded_size(); i += 4) {
+        const __m128 x = _mm_load_ps(&v.x[i]);
+        const __m128 y = _mm_load_ps(&v.y[i]);
+        const __m128 z = _mm_load_ps(&v.z[i]);
+        _mm_store_ps(&v.x[i], mm.row(0, x, y, z));
+        _mm_store_ps(&v.y[i], mm.row(1, x, y, z));
+        _mm_store_ps(&v.z[i], mm.row(2, x, y, z));
+    }
+}
+
+// clip_outcode of 4 vertices, in the low 4 bytes
+__attribute__((target("sse2")))
+inline __m128i outcodes(__m128 x, __m128 y, __m128 z, __m128 w) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 nw = _mm_sub_ps(zero, w);
+    const __m128 g = _mm_mul_ps(_mm_set1_ps(static_cast<float>(GUARD_BAND)), w);
+    const __m128 ng = _mm_sub_ps(zero, g);
+
+    const __m128 left = _mm_cmplt_ps(x, nw);
+    const __m128 right = _mm_andnot_ps(left, _mm_cmpgt_ps(x, w));
+    const __m128 bottom = _mm_cmplt_ps(y, nw);
+    const __m128 top = _mm_andnot_ps(bottom, _mm_cmpgt_ps(y, w));
+    const __m128 behind = _mm_cmplt_ps(z, zero);
+    const __m128 beyond = _mm_andnot_ps(behind, _mm_cmpgt_ps(z, w));
+    const __m128 guard = _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(x, ng), _mm_cmpgt_ps(x, g)), _mm_or_ps(_mm_cmplt_ps(y, ng), _mm_cmpgt_ps(y, g)));
+
+    __m128 code = _mm_and_ps(left, _mm_set1_ps(CLIP_LEFT));
+    code = _mm_add_ps(code, _mm_and_ps(right, _mm_set1_ps(CLIP_RIGHT)));
+    code = _mm_add_ps(code, _mm_and_ps(bottom, _mm_set1_ps(CLIP_BOTTOM)));
+    code = _mm_add_ps(code, _mm_and_ps(top, _mm_set1_ps(CLIP_TOP)));
+    code = _mm_add_ps(code, _mm_and_ps(behind, _mm_set1_ps(CLIP_NEAR)));
+    code = _mm_add_ps(code, _mm_and_ps(beyond, _mm_set1_ps(CLIP_FAR)));
+    code = _mm_add_ps(code, _mm_and_ps(guard, _mm_set1_ps(CLIP_GUARD)));
+    const __m128i c32 = _mm_cvttps_epi32(code);
+    return _mm_packus_epi16(_mm_packs_epi32(c32, c32), c32);
+}
+
+// the viewport map is done in float too, window positions can come out a pixel off the scalar
+// version's (which maps in double) right on a pixel boundary
+__attribute__((target("sse2")))
+inline void transform_to_window(const VertexArray<float>& v, const Mat4<float>& m, int width, int height, uint8_t* codes, ScreenArray<float>& out) {
+    const Mat4x4f mm (m);
+    const __m128 hw = _mm_set1_ps(width / 2.0f);
+    const __m128 hh = _mm_set1_ps(height / 2.0f);
+    const __m128 h = _mm_set1_ps(static_cast<float>(height));
+
+    out.resize(v.size());
+    for (std::size_t i = 0; i < v.padded_size(); i += 4) {
+        const __m128 x = _mm_load_ps(&v.x[i]);
+        const __m128 y = _mm_load_ps(&v.y[i]);
+        const __m128 z = _mm_load_ps(&v.z[i]);
+        const __m128 cx = mm.row(0, x, y, z);
+        const __m128 cy = mm.row(1, x, y, z);
+        const __m128 cz = mm.row(2, x, y, z);
+        const __m128 cw = mm.row(3, x, y, z);
+        const int c = _mm_cvtsi128_si32(outcodes(cx, cy, cz, cw));
+        std::memcpy(&codes[i], &c, 4);
+
+        const __m128 inv_w = _mm_div_ps(_mm_set1_ps(1.0f), cw);
+        const __m128 sx = _mm_add_ps(_mm_mul_ps(hw, _mm_mul_ps(cx, inv_w)), hw);
+        const __m128 sy = _mm_sub_ps(h, _mm_add_ps(_mm_mul_ps(hh, _mm_mul_ps(cy, inv_w)), hh));
+        _mm_store_si128(reinterpret_cast<__m128i*>(&out.x[i]), _mm_cvttps_epi32(sx));
+        _mm_store_si128(reinterpret_cast<__m128i*>(&out.y[i]), _mm_cvttps_epi32(sy));
+        _mm_store_ps(&out.z[i], _mm_mul_ps(cz, inv_w));
+    }
+}
+
+} // namespace sse2
+
+namespace avx {
+
+__attribute__((target("avx")))
+inline void translate_vertices(VertexArray<double>& v, const Point<double>& t) {
+    const __m256d tx = _mm256_set1_pd(t.x);
+    const __m256d ty = _mm256_set1_pd(t.y);
+    const __m256d tz = _mm256_set1_pd(t.z);
+    for (std::size_t i = 0; i < v.padded_size(); i += 4) {
+        _mm256_store_pd(&v.x[i], _mm256_add_pd(_mm256_load_pd(&v.x[i]), tx));
+        _mm256_store_pd(&v.y[i], _mm256_add_pd(_mm256_load_pd(&v.y[i]), ty));
+        _mm256_store_pd(&v.z[i], _mm256_add_pd(_mm256_load_pd(&v.z[i]), tz));
+    }
+}
+
+__attribute__((target("avx")))
+inline void scale_vertices(VertexArray<double>& v, const Point<double>& origin, double s) {
+    const __m256d ox = _mm256_set1_pd(origin.x);
+    const __m256d oy = _mm256_set1_pd(origin.y);
+    const __m256d oz = _mm256_set1_pd(origin.z);
+    const __m256d vs = _mm256_set1_pd(s);
+    for (std::size_t i = 0; i < v.padded_size(); i += 4) {
+        _mm256_store_pd(&v.x[i], _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_load_pd(&v.x[i]), ox), vs), ox));
+        _mm256_store_pd(&v.y[i], _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_load_pd(&v.y[i]), oy), vs), oy));
+        _mm256_store_pd(&v.z[i], _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_load_pd(&v.z[i]), oz), vs), oz));
+    }
+}
+
+// m broadcast into registers once per batch, the output arrays could alias m so the
+// compiler can't hoist these loads out of the loop by itself
+struct Mat4x4 {
+    __m256d m[4][4];
+
+    __attribute__((target("avx")))
+    Mat4x4(const Mat4<double>& mat) {
+        for (int r = 0; r < 4; r++) {
+            for (int c = 0; c < 4; c++) {
+                m[r][c] = _mm256_set1_pd(mat.m[r][c]);
+            }
+        }
+    }
+
+    // one row of m applied to 4 vertices
+    __attribute__((target("avx")))
+    __m256d row(int r, __m256d x, __m256d y, __m256d z) const {
+        __m256d acc = _mm256_mul_pd(m[r][0], x);
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(m[r][1], y));
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(m[r][2], z));
+        return _mm256_add_pd(acc, m[r][3]);
+    }
+};
+
+__attribute__((target("avx")))
+inline void transform_vertices(VertexArray<double>& v, const Mat4<double>& m) {
+    const Mat4x4 mm (m);
+    for (std::size_t i = 0; i < v.padded_size(); i += 4) {
+        const __m256d x = _mm256_load_pd(&v.x[i]);
+        const __m256d y = _mm256_load_pd(&v.y[i]);
+        const __m256d z = _mm256_load_pd(&v.z[i]);
+        _mm256_store_pd(&v.x[i], mm.row(0, x, y, z));
+        _mm256_store_pd(&v.y[i], mm.row(1, x, y, z));
+        _mm256_store_pd(&v.z[i], mm.row(2, x, y, z));
+    }
+}
+
+// clip_outcode of 4 vertices, in the low 4 bytes. works like sse2's.
+__attribute__((target("avx")))
+inline __m128i outcodes(__m256d x, __m256d y, __m256d z, __m256d w) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d nw = _mm256_sub_pd(zero, w);
+    const __m256d g = _mm256_mul_pd(_mm256_set1_pd(GUARD_BAND), w);
+    const __m256d ng = _mm256_sub_pd(zero, g);
+
+    const __m256d left = _mm256_cmp_pd(x, nw, _CMP_LT_OQ);
+    const __m256d right = _mm256_andnot_pd(left, _mm256_cmp_pd(x, w, _CMP_GT_OQ));
+    const __m256d bottom = _mm256_cmp_pd(y, nw, _CMP_LT_OQ);
+    const __m256d top = _mm256_andnot_pd(bottom, _mm256_cmp_pd(y, w, _CMP_GT_OQ));
+    const __m256d behind = _mm256_cmp_pd(z, zero, _CMP_LT_OQ);
+    const __m256d beyond = _mm256_andnot_pd(behind, _mm256_cmp_pd(z, w, _CMP_GT_OQ));
+    const __m256d guard = _mm256_or_pd(
+        _mm256_or_pd(_mm256_cmp_pd(x, ng, _CMP_LT_OQ), _mm256_cmp_pd(x, g, _CMP_GT_OQ)),
+        _mm256_or_pd(_mm256_cmp_pd(y, ng, _CMP_LT_OQ), _mm256_cmp_pd(y, g, _CMP_GT_OQ)));
+
+    __m256d code = _mm256_and_pd(left, _mm256_set1_pd(CLIP_LEFT));
+    code = _mm256_add_pd(code, _mm256_and_pd(right, _mm256_set1_pd(CLIP_RIGHT)));
+    code = _mm256_add_pd(code, _mm256_and_pd(bottom, _mm256_set1_pd(CLIP_BOTTOM)));
+    code = _mm256_add_pd(code, _mm256_and_pd(top, _mm256_set1_pd(CLIP_TOP)));
+    code = _mm256_add_pd(code, _mm256_and_pd(behind, _mm256_set1_pd(CLIP_NEAR)));
+    code = _mm256_add_pd(code, _mm256_and_pd(beyond, _mm256_set1_pd(CLIP_FAR)));
+    code = _mm256_add_pd(code, _mm256_and_pd(guard, _mm256_set1_pd(CLIP_GUARD)));
+    const __m128i c32 = _mm256_cvttpd_epi32(code);
+    return _mm_packus_epi16(_mm_packs_epi32(c32, c32), c32);
+}
+
+__attribute__((target("avx")))
+inline void transform_to_window(const VertexArray<double>& v, const Mat4<double>& m, int width, int height, uint8_t* codes, ScreenArray<double>& out) {
+    const Mat4x4 mm (m);
+    const __m256d hw = _mm256_set1_pd(width / 2.0);
+    const __m256d hh = _mm256_set1_pd(height / 2.0);
+    const __m256d h = _mm256_set1_pd(height);
+
+    out.resize(v.size());
+    for (std::size_t i = 0; i < v.padded_size(); i += 4) {
+        const __m256d x = _mm256_load_pd(&v.x[i]);
+        const __m256d y = _mm256_load_pd(&v.y[i]);
+        const __m256d z = _mm256_load_pd(&v.z[i]);
+        const __m256d cx = mm.row(0, x, y, z);
+        const __m256d cy = mm.row(1, x, y, z);
+        const __m256d cz = mm.row(2, x, y, z);
+        const __m256d cw = mm.row(3, x, y, z);
+        const int c = _mm_cvtsi128_si32(outcodes(cx, cy, cz, cw));
+        std::memcpy(&codes[i], &c, 4);
+
+        const __m256d inv_w = _mm256_div_pd(_mm256_set1_pd(1.0), cw);
+        const __m256d sx = _mm256_add_pd(_mm256_mul_pd(hw, _mm256_mul_pd(cx, inv_w)), hw);
+        const __m256d sy = _mm256_sub_pd(h, _mm256_add_pd(_mm256_mul_pd(hh, _mm256_mul_pd(cy, inv_w)), hh));
+        _mm_store_si128(reinterpret_cast<__m128i*>(&out.x[i]), _mm256_cvttpd_epi32(sx));
+        _mm_store_si128(reinterpret_cast<__m128i*>(&out.y[i]), _mm256_cvttpd_epi32(sy));
+        _mm256_store_pd(&out.z[i], _mm256_mul_pd(cz, inv_w));
+    }
+}
+
+// float versions, twice the lanes of the double ones
+
+__attribute__((target("avx")))
+inline void translate_vertices(VertexArray<float>& v, const Point<float>& t) {
+    const __m256 tx = _mm256_set1_ps(t.x);
+    const __m256 ty = _mm256_set1_ps(t.y);
+    const __m256 tz = _mm256_set1_ps(t.z);
+    for (std::size_t i = 0; i < v.padded_size(); i += 8) {
+        _mm256_store_ps(&v.x[i], _mm256_add_ps(_mm256_load_ps(&v.x[i]), tx));
+        _mm256_store_ps(&v.y[i], _mm256_add_ps(_mm256_load_ps(&v.y[i]), ty));
+        _mm256_store_ps(&v.z[i], _mm256_add_ps(_mm256_load_ps(&v.z[i]), tz));
+    }
+}
+
+__attribute__((target("avx")))
+inline void scale_vertices(VertexArray<float>& v, const Point<float>& origin, float s) {
+    const __m256 ox = _mm256_set1_ps(origin.x);
+    const __m256 oy = _mm256_set1_ps(origin.y);
+    const __m256 oz = _mm256_set1_ps(origin.z);
+    const __m256 vs = _mm256_set1_ps(s);
+    for (std::size_t i = 0; i < v.padded_size(); i += 8) {
+        _mm256_store_ps(&v.x[i], _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(&v.x[i]), ox), vs), ox));
+        _mm256_store_ps(&v.y[i], _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(&v.y[i]), oy), vs), oy));
+        _mm256_store_ps(&v.z[i], _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(&v.z[i]), oz), vs), oz));
+    }
+}
+
+struct Mat4x8f {
+    __m256 m[4][4];
+
+    __attribute__((target("avx")))
+    Mat4x8f(const Mat4<float>& mat) {
+        for (int r = 0; r < 4; r++) {
+            for (int c = 0; c < 4; c++) {
+                m[r][c] = _mm256_set1_ps(mat.m[r][c]);
+            }
+        }
+    }
+
+    // one row of m applied to 8 vertices
+    __attribute__((target("avx")))
+    __m256 row(int r, __m256 x, __m256 y, __m256 z) const {
+        __m256 acc = _mm256_mul_ps(m[r][0], x);
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(m[r][1], y));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(m[r][2], z));
+        return _mm256_add_ps(acc, m[r][3]);
+    }
+};
+
+__attribute__((target("avx")))
+inline void transform_vertices(VertexArray<float>& v, const Mat4<float>& m) {
+    const Mat4x8f mm (m);
+    for (std::size_t i = 0; i < v.padded_size(); i += 8) {
+        const __m256 x = _mm256_load_ps(&v.x[i]);
+        const __m256 y = _mm256_load_ps(&v.y[i]);
+        const __m256 z = _mm256_load_ps(&v.z[i]);
+        _mm256_store_ps(&v.x[i], mm.row(0, x, y, z));
+        _mm256_store_ps(&v.y[i], mm.row(1, x, y, z));
+        _mm256_store_ps(&v.z[i], mm.row(2, x, y, z));
+    }
+}
+
+// clip_outcode of 8 vertices, in the low 8 bytes
+__attribute__((target("avx")))
+inline __m128i outcodes(__m256 x, __m256 y, __m256 z, __m256 w) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 nw = _mm256_sub_ps(zero, w);
+    const __m256 g = _mm256_mul_ps(_mm256_set1_ps(static_cast<float>(GUARD_BAND)), w);
+    const __m256 ng = _mm256_sub_ps(zero, g);
+
+    const __m256 left = _mm256_cmp_ps(x, nw, _CMP_LT_OQ);
+    const __m256 right = _mm256_andnot_ps(left, _mm256_cmp_ps(x, w, _CMP_GT_OQ));
+    const __m256 bottom = _mm256_cmp_ps(y, nw, _CMP_LT_OQ);
+    const __m256 top = _mm256_andnot_ps(bottom, _mm256_cmp_ps(y, w, _CMP_GT_OQ));
+    const __m256 behind = _mm256_cmp_ps(z, zero, _CMP_LT_OQ);
+    const __m256 beyond = _mm256_andnot_ps(behind, _mm256_cmp_ps(z, w, _CMP_GT_OQ));
+    const __m256 guard = _mm256_or_ps(
+        _mm256_or_ps(_mm256_cmp_ps(x, ng, _CMP_LT_OQ), _mm256_cmp_ps(x, g, _CMP_GT_OQ)),
+        _mm256_or_ps(_mm256_cmp_ps(y, ng, _CMP_LT_OQ), _mm256_cmp_ps(y, g, _CMP_GT_OQ)));
+
+    __m256 code = _mm256_and_ps(left, _mm256_set1_ps(CLIP_LEFT));
+    code = _mm256_add_ps(code, _mm256_and_ps(right, _mm256_set1_ps(CLIP_RIGHT)));
+    code = _mm256_add_ps(code, _mm256_and_ps(bottom, _mm256_set1_ps(CLIP_BOTTOM)));
+    code = _mm256_add_ps(code, _mm256_and_ps(top, _mm256_set1_ps(CLIP_TOP)));
+    code = _mm256_add_ps(code, _mm256_and_ps(behind, _mm256_set1_ps(CLIP_NEAR)));
+    code = _mm256_add_ps(code, _mm256_and_ps(beyond, _mm256_set1_ps(CLIP_FAR)));
+    code = _mm256_add_ps(code, _mm256_and_ps(guard, _mm256_set1_ps(CLIP_GUARD)));
+    const __m256i c32 = _mm256_cvttps_epi32(code);
+    const __m128i c16 = _mm_packs_epi32(_mm256_castsi256_si128(c32), _mm256_extractf128_si256(c32, 1));
+    return _mm_packus_epi16(c16, c16);
+}
+
+// viewport map in float like sse2's
+__attribute__((target("avx")))
+inline void transform_to_window(const VertexArray<float>& v, const Mat4<float>& m, int width, int height, uint8_t* codes, ScreenArray<float>& out) {
+    const Mat4x8f mm (m);
+    const __m256 hw = _mm256_set1_ps(width / 2.0f);
+    const __m256 hh = _mm256_set1_ps(height / 2.0f);
+    const __m256 h = _mm256_set1_ps(static_cast<float>(height));
+
+    out.resize(v.size());
+    for (std::size_t i = 0; i < v.padded_size(); i += 8) {
+        const __m256 x = _mm256_load_ps(&v.x[i]);
+        const __m256 y = _mm256_load_ps(&v.y[i]);
+        const __m256 z = _mm256_load_ps(&v.z[i]);
+        const __m256 cx = mm.row(0, x, y, z);
+        const __m256 cy = mm.row(1, x, y, z);
+        const __m256 cz = mm.row(2, x, y, z);
+        const __m256 cw = mm.row(3, x, y, z);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(&codes[i]), outcodes(cx, cy, cz, cw));
+
+        const __m256 inv_w = _mm256_div_ps(_mm256_set1_ps(1.0f), cw);
+        const __m256 sx = _mm256_add_ps(_mm256_mul_ps(hw, _mm256_mul_ps(cx, inv_w)), hw);
+        const __m256 sy = _mm256_sub_ps(h, _mm256_add_ps(_mm256_mul_ps(hh, _mm256_mul_ps(cy, inv_w)), hh));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(&out.x[i]), _mm256_cvttps_epi32(sx));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(&out.y[i]), _mm256_cvttps_epi32(sy));
+        _mm256_store_ps(&out.z[i], _mm256_mul_ps(cz, inv_w));
+    }
+}
+
+} // namespace avx
+#endif
+
+// dispatching entry points, generic Numerics fall through to the scalar kernels
+
+template <Numeric N>
+void translate_vertices(VertexArray<N>& v, const Point<N>& t) {
+    scalar::translate_vertices(v, t);
+}
+
+template <Numeric N>
+void scale_vertices(VertexArray<N>& v, const Point<N>& origin, N s) {
+    scalar::scale_vertices(v, origin, s);
+}
+
+template <Numeric N>
+void transform_vertices(VertexArray<N>& v, const Mat4<N>& m) {
+    scalar::transform_vertices(v, m);
+}
+
+template <Numeric N>
+void transform_to_window(const VertexArray<N>& v, const Mat4<N>& m, int width, int height, uint8_t* codes, ScreenArray<N>& out) {
+    scalar::transform_to_window(v, m, width, height, codes, out);
+}
+
+#if ENGINE_SIMD_X86
+#define ENGINE_SIMD_DISPATCH(fn, ...) \
+    switch (detect_simd_level()) { \
+        case SimdLevel::AVX: \
+            return avx::fn(__VA_ARGS__); \
+        case SimdLevel::SSE2: \
+            return sse2::fn(__VA_ARGS__); \
+        default: \
+            return scalar::fn(__VA_ARGS__); \
+    }
+
+inline void translate_vertices(VertexArray<double>& v, const Point<double>& t) {
+    ENGINE_SIMD_DISPATCH(translate_vertices, v, t)
+}
+
+inline void scale_vertices(VertexArray<double>& v, const Point<double>& origin, double s) {
+    ENGINE_SIMD_DISPATCH(scale_vertices, v, origin, s)
+}
+
+inline void transform_vertices(VertexArray<double>& v, const Mat4<double>& m) {
+    ENGINE_SIMD_DISPATCH(transform_vertices, v, m)
+}
+
+inline void transform_to_window(const VertexArray<double>& v, const Mat4<double>& m, int width, int height, uint8_t* codes, ScreenArray<double>& out) {
+    ENGINE_SIMD_DISPATCH(transform_to_window, v, m, width, height, codes, out)
+}
+
+inline void translate_vertices(VertexArray<float>& v, const Point<float>& t) {
+    ENGINE_SIMD_DISPATCH(translate_vertices, v, t)
+}
+
+inline void scale_vertices(VertexArray<float>& v, const Point<float>& origin, float s) {
+    ENGINE_SIMD_DISPATCH(scale_vertices, v, origin, s)
+}
+
+inline void transform_vertices(VertexArray<float>& v, const Mat4<float>& m) {
+    ENGINE_SIMD_DISPATCH(transform_vertices, v, m)
+}
+
+inline void transform_to_window(const VertexArray<float>& v, const Mat4<float>& m, int width, int height, uint8_t* codes, ScreenArray<float>& out) {
+    ENGINE_SIMD_DISPATCH(transform_to_window, v, m, width, height, codes, out)
+}
+
+#undef ENGINE_SIMD_DISPATCH
+#endif
@@ -0,0 +1,392 @@
+#pragma once
+#include <vector>
+#include <queue>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include "Point.hpp"
+#include "VertexArray.hpp"
+#include "Triangle.hpp"
+
+// sum of squared distances to a set of planes, as the symmetric 4x4 matrix Q with
+// error(v) = [v 1] Q [v 1]^T. only the upper triangle is stored.
+struct Quadric {
+    double xx = 0, xy = 0, xz = 0, xw = 0;
+    double yy = 0, yz = 0, yw = 0;
+    double zz = 0, zw = 0;
+    double ww = 0;
+
+    // plane n.p + d = 0, n unit length, scaled by weight
+    static Quadric plane(double nx, double ny, double nz, double d, double weight = 1.0) {
+        Quadric q;
+        q.xx = weight * nx * nx; q.xy = weight * nx * ny; q.xz = weight * nx * nz; q.xw = weight * nx * d;
+        q.yy = weight * ny * ny; q.yz = weight * ny * nz; q.yw = weight * ny * d;
+        q.zz = weight * nz * nz; q.zw = weight * nz * d;
+        q.ww = weight * d * d;
+        return q;
+    }
+
+    Quadric& operator+=(const Quadric& rhs) {
+        xx += rhs.xx; xy += rhs.xy; xz += rhs.xz; xw += rhs.xw;
+        yy += rhs.yy; yz += rhs.yz; yw += rhs.yw;
+        zz += rhs.zz; zw += rhs.zw;
+        ww += rhs.ww;
+        return *this;
+    }
+
+    Quadric operator+(const Quadric& rhs) const {
+        Quadric r = *this;
+        r += rhs;
+        return r;
+    }
+
+    double error(double x, double y, double z) const {
+        return xx*x*x + 2*xy*x*y + 2*xz*x*z + 2*xw*x
+            + yy*y*y + 2*yz*y*z + 2*yw*y
+            + zz*z*z + 2*zw*z
+            + ww;
+    }
+
+    // the point of least error, false when the planes don't pin one down (all parallel, or all
+    // through one line)
+    bool minimum(double& x, double& y, double& z) const {
+        const double det = xx*(yy*zz - yz*yz) - xy*(xy*zz - yz*xz) + xz*(xy*yz - yy*xz);
+        const double trace = xx + yy + zz;
+        if (std::abs(det) <= 1e-9 * trace * trace * trace) {
+            return false;
+        }
+        // cramer's rule on the 3x3 block against -[xw yw zw]
+        const double bx = -xw, by = -yw, bz = -zw;
+        x = (bx*(yy*zz - yz*yz) - xy*(by*zz - yz*bz) + xz*(by*yz - yy*bz)) / det;
+        y = (xx*(by*zz - yz*bz) - bx*(xy*zz - yz*xz) + xz*(xy*bz - by*xz)) / det;
+        z = (xx*(yy*bz - by*yz) - xy*(xy*bz - by*xz) + bx*(xy*yz - yy*xz)) / det;
+        return true;
+    }
+};
+
+// quadric error edge collapse (Garland and Heckbert). every vertex starts with the planes of its
+// faces, an edge collapse merges its two vertices at the point closest to both sets of planes and
+// the cheapest collapse always goes first. open borders get extra planes at right angles to their
+// face so they stay in place. collapses that would fold a face over or pinch the surface into a
+// non-manifold shape are skipped.
+// collapse_to() can be called repeatedly with falling targets to take snapshots of ever coarser
+// versions of one surface.
+template <Numeric N>
+class QuadricSimplifier {
+public:
+    // weight of the planes holding open borders in place, relative to a face's own plane
+    static constexpr double BORDER_WEIGHT = 100.0;
+
+    explicit QuadricSimplifier(const Geometry<N>& g)
+        : px(g.verts.size()), py(g.verts.size()), pz(g.verts.size()),
+          quadrics(g.verts.size()), version(g.verts.size(), 0), vertex_alive(g.verts.size(), 1),
+          faces{g.faces}, face_alive(g.faces.size(), 1), vertex_faces(g.verts.size()),
+          live_faces{g.faces.size()}
+    {
+        for (std::size_t i = 0; i < g.verts.size(); i++) {
+            px[i] = static_cast<double>(g.verts.x[i]);
+            py[i] = static_cast<double>(g.verts.y[i]);
+            pz[i] = static_cast<double>(g.verts.z[i]);
+        }
+
+        for (uint32_t f = 0; f < faces.size(); f++) {
+            const Face& face = faces[f];
+            double nx, ny, nz;
+            if (!face_normal(face.a, face.b, face.c, nx, ny, nz)) {
+                continue;
+            }
+            const Quadric q = Quadric::plane(nx, ny, nz, -(nx*px[face.a] + ny*py[face.a] + nz*pz[face.a]));
+            for (uint32_t v : {face.a, face.b, face.c}) {
+                quadrics[v] += q;
+                vertex_faces[v].push_back(f);
+            }
+        }
+
+        for (std::size_t e = 0; e < g.edges.size(); e++) {
+            const auto [f0, f1] = g.edge_faces[e];
+            if (f1 == Geometry<N>::NO_FACE) {
+                add_border_plane(g.edges[e].a, g.edges[e].b, g.normals[f0]);
+            }
+        }
+
+        for (const Edge& e : g.edges) {
+            push(e.a, e.b);
+        }
+    }
+
+    // collapse edges cheapest first until no more than target faces are left, or no collapse
+    // that keeps the surface sound is left
+    void collapse_to(std::size_t target) {
+        while (live_faces > target && !heap.empty()) {
+            const Candidate c = heap.top();
+            heap.pop();
+            if (!vertex_alive[c.u] || !vertex_alive[c.v] || version[c.u] != c.version_u || version[c.v] != c.version_v) {
+                continue; // stale, one of its vertices changed since
+            }
+            if (!can_collapse(c.u, c.v, c.x, c.y, c.z)) {
+                continue;
+            }
+            collapse(c);
+        }
+    }
+
+    std::size_t face_count() const {
+        return live_faces;
+    }
+
+    // how far the surface may have moved from the original, the square root of the largest
+    // quadric error paid so far. never less than the largest distance of any merged vertex from
+    // the planes it started on.
+    double error() const {
+        return std::sqrt(std::max(max_cost, 0.0));
+    }
+
+    // the surface as it is now, with unused vertices dropped
+    Geometry<N> geometry() const {
+        std::vector<uint32_t> remap (px.size(), UINT32_MAX);
+        std::vector<Point<N>> verts;
+        std::vector<Face> out;
+        out.reserve(live_faces);
+        const auto index = [&](uint32_t v) {
+            if (remap[v] == UINT32_MAX) {
+                remap[v] = static_cast<uint32_t>(verts.size());
+                verts.push_back(Point<N>(static_cast<N>(px[v]), static_cast<N>(py[v]), static_cast<N>(pz[v])));
+            }
+            return remap[v];
+        };
+        for (std::size_t f = 0; f < faces.size(); f++) {
+            if (face_alive[f]) {
+                out.push_back(Face{index(faces[f].a), index(faces[f].b), index(faces[f].c)});
+            }
+        }
+        return Geometry<N>(VertexArray<N>(verts), std::move(out));
+    }
+
+private:
+    struct Candidate {
+        double cost;
+        uint32_t u;
+        uint32_t v;
+        uint32_t version_u;
+        uint32_t version_v;
+        double x;
+        double y;
+        double z;
+
+        bool operator>(const Candidate& rhs) const {
+            return cost > rhs.cost;
+        }
+    };
+
+    std::vector<double> px;
+    std::vector<double> py;
+    std::vector<double> pz;
+    std::vector<Quadric> quadrics;
+    std::vector<uint32_t> version; // bumped whenever a vertex moves, invalidating its candidates
+    std::vector<uint8_t> vertex_alive;
+
+    std::vector<Face> faces;
+    std::vector<uint8_t> face_alive;
+    std::vector<std::vector<uint32_t>> vertex_faces; // may still list dead faces
+    std::size_t live_faces;
+
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> heap;
+    double max_cost = 0;
+
+    // scratch for can_collapse
+    std::vector<uint32_t> ring_u;
+    std::vector<uint32_t> ring_v;
+
+    bool face_normal(uint32_t a, uint32_t b, uint32_t c, double& nx, double& ny, double& nz) const {
+        return cross(px[a], py[a], pz[a], px[b], py[b], pz[b], px[c], py[c], pz[c], nx, ny, nz, true);
+    }
+
+    // (b - a) x (c - a), normalized when unit is set. false for a degenerate triangle.
+    static bool cross(double ax, double ay, double az, double bx, double by, double bz, double cx, double cy, double cz,
+                      double& nx, double& ny, double& nz, bool unit) {
+        const double ux = bx - ax, uy = by - ay, uz = bz - az;
+        const double vx = cx - ax, vy = cy - ay, vz = cz - az;
+        nx = uy*vz - uz*vy;
+        ny = uz*vx - ux*vz;
+        nz = ux*vy - uy*vx;
+        const double len = std::sqrt(nx*nx + ny*ny + nz*nz);
+        if (len == 0) {
+            return false;
+        }
+        if (unit) {
+            nx /= len;
+            ny /= len;
+            nz /= len;
+        }
+        return true;
+    }
+
+    // a plane through edge ab at right angles to its face
+    void add_border_plane(uint32_t a, uint32_t b, const Point<N>& normal) {
+        const Point<double> face_normal = static_cast<Point<double>>(normal);
+        const double ex = px[b] - px[a], ey = py[b] - py[a], ez = pz[b] - pz[a];
+        double nx = ey*face_normal.z - ez*face_normal.y;
+        double ny = ez*face_normal.x - ex*face_normal.z;
+        double nz = ex*face_normal.y - ey*face_normal.x;
+        const double len = std::sqrt(nx*nx + ny*ny + nz*nz);
+        if (len == 0) {
+            return;
+        }
+        nx /= len;
+        ny /= len;
+        nz /= len;
+        const Quadric q = Quadric::plane(nx, ny, nz, -(nx*px[a] + ny*py[a] + nz*pz[a]), BORDER_WEIGHT);
+        quadrics[a] += q;
+        quadrics[b] += q;
+    }
+
+    // queue the collapse of edge uv at its cheapest position
+    void push(uint32_t u, uint32_t v) {
+        const Quadric q = quadrics[u] + quadrics[v];
+        Candidate c {0, u, v, version[u], version[v], 0, 0, 0};
+        if (q.minimum(c.x, c.y, c.z)) {
+            c.cost = q.error(c.x, c.y, c.z);
+        } else {
+            // no single best point, take the best of the ends and the middle
+            const double options[3][3] = {
+                {px[u], py[u], pz[u]},
+                {px[v], py[v], pz[v]},
+                {(px[u] + px[v]) / 2, (py[u] + py[v]) / 2, (pz[u] + pz[v]) / 2},
+            };
+            c.cost = INFINITY;
+            for (const auto& o : options) {
+                const double cost = q.error(o[0], o[1], o[2]);
+                if (cost < c.cost) {
+                    c.cost = cost;
+                    c.x = o[0];
+                    c.y = o[1];
+                    c.z = o[2];
+                }
+            }
+        }
+        heap.push(c);
+    }
+
+    // the live neighbours of v, sorted
+    void ring(uint32_t v, std::vector<uint32_t>& out) const {
+        out.clear();
+        for (uint32_t f : vertex_faces[v]) {
+            if (!face_alive[f]) {
+                continue;
+            }
+            for (uint32_t w : {faces[f].a, faces[f].b, faces[f].c}) {
+                if (w != v) {
+                    out.push_back(w);
+                }
+            }
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    }
+
+    bool can_collapse(uint32_t u, uint32_t v, double x, double y, double z) {
+        // link condition, u and v may only share the neighbours across the faces they share,
+        // anything else would pinch the surface
+        ring(u, ring_u);
+        ring(v, ring_v);
+        std::size_t common = 0;
+        for (std::size_t i = 0, j = 0; i < ring_u.size() && j < ring_v.size();) {
+            if (ring_u[i] < ring_v[j]) {
+                i++;
+            } else if (ring_v[j] < ring_u[i]) {
+                j++;
+            } else {
+                common += 1;
+                i++;
+                j++;
+            }
+        }
+        std::size_t shared = 0;
+        for (uint32_t f : vertex_faces[u]) {
+            const Face& face = faces[f];
+            if (face_alive[f] && (face.a == v || face.b == v || face.c == v)) {
+                shared += 1;
+            }
+        }
+        if (shared == 0 || common != shared) {
+            return false;
+        }
+
+        // no face left after the collapse may turn over
+        for (const uint32_t moved : {u, v}) {
+            const uint32_t other = moved == u ? v : u;
+            for (uint32_t f : vertex_faces[moved]) {
+                const Face& face = faces[f];
+                if (!face_alive[f] || face.a == other || face.b == other || face.c == other) {
+                    continue;
+                }
+                double p[3][3];
+                int k = 0;
+                for (uint32_t w : {face.a, face.b, face.c}) {
+                    if (w == moved) {
+                        p[k][0] = x; p[k][1] = y; p[k][2] = z;
+                    } else {
+                        p[k][0] = px[w]; p[k][1] = py[w]; p[k][2] = pz[w];
+                    }
+                    k++;
+                }
+                double bx, by, bz;
+                double ax, ay, az;
+                if (!face_normal(face.a, face.b, face.c, bx, by, bz)) {
+                    continue;
+                }
+                if (!cross(p[0][0], p[0][1], p[0][2], p[1][0], p[1][1], p[1][2], p[2][0], p[2][1], p[2][2], ax, ay, az, true)
+                    || ax*bx + ay*by + az*bz < 0.2) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // v merges into u at the candidate's position
+    void collapse(const Candidate& c) {
+        const uint32_t u = c.u;
+        const uint32_t v = c.v;
+        max_cost = std::max(max_cost, c.cost);
+
+        px[u] = c.x;
+        py[u] = c.y;
+        pz[u] = c.z;
+        quadrics[u] += quadrics[v];
+        vertex_alive[v] = 0;
+        version[u] += 1;
+
+        for (uint32_t f : vertex_faces[v]) {
+            if (!face_alive[f]) {
+                continue;
+            }
+            Face& face = faces[f];
+            if (face.a == u || face.b == u || face.c == u) {
+                face_alive[f] = 0;
+                live_faces -= 1;
+                continue;
+            }
+            if (face.a == v) {
+                face.a = u;
+            } else if (face.b == v) {
+                face.b = u;
+            } else {
+                face.c = u;
+            }
+            vertex_faces[u].push_back(f);
+        }
+        vertex_faces[v].clear();
+        vertex_faces[v].shrink_to_fit();
+
+        std::vector<uint32_t>& list = vertex_faces[u];
+        list.erase(std::remove_if(list.begin(), list.end(), [&](uint32_t f) { return !face_alive[f]; }), list.end());
+
+        ring(u, ring_u);
+        for (uint32_t w : ring_u) {
+            push(u, w);
+        }
+    }
+};
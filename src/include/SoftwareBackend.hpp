@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include "RenderBackend.hpp"
+#include "Framebuffer.hpp"
+#include "LineBatch.hpp"
+
+// draws into a Framebuffer on the CPU, no display needed
+class SoftwareBackend : public RenderBackend {
+public:
+    SoftwareBackend(int width, int height) : framebuffer{width, height} {}
+
+    void clear(int red, int green, int blue) override {
+        framebuffer.fill(Framebuffer::pack(red, green, blue));
+    }
+
+    int draw_lines(const LineBatch& batch) override {
+        int draw_calls = 0;
+        for (const LineGroup& g : batch.line_groups()) {
+            if (g.size() == 0) {
+                continue;
+            }
+            const uint32_t colour = Framebuffer::pack(g.red, g.green, g.blue);
+            for (std::size_t i = 0; i < g.points.size(); i += 4) {
+                framebuffer.draw_line(g.points[i], g.points[i+1], g.points[i+2], g.points[i+3], colour);
+            }
+            draw_calls += 1;
+        }
+        return draw_calls;
+    }
+
+    void draw_framebuffer(const Framebuffer& frame) override {
+        framebuffer.pixels = frame.pixels;
+    }
+
+    void present() override {
+        frames += 1;
+    }
+
+    const Framebuffer& frame() const {
+        return framebuffer;
+    }
+
+    long long frames_presented() const {
+        return frames;
+    }
+
+private:
+    Framebuffer framebuffer;
+    long long frames = 0;
+};
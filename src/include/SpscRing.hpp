@@ -0,0 +1,43 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+// single producer single consumer ring buffer of trivially copyable items. push() never blocks,
+// when the consumer falls behind new items are dropped and counted.
+template <typename T, std::size_t CAPACITY>
+class SpscRing {
+public:
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+    bool push(const T& item) {
+        const std::size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == CAPACITY) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        items[h & (CAPACITY - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // fn(item) for everything pushed so far, oldest first
+    template <typename F>
+    void drain(F&& fn) {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        const std::size_t h = head.load(std::memory_order_acquire);
+        for (; t != h; t++) {
+            fn(items[t & (CAPACITY - 1)]);
+        }
+        tail.store(t, std::memory_order_release);
+    }
+
+    std::size_t dropped_count() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    T items[CAPACITY];
+    alignas(64) std::atomic<std::size_t> head {0};
+    alignas(64) std::atomic<std::size_t> tail {0};
+    std::atomic<std::size_t> dropped {0};
+};
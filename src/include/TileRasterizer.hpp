@@ -0,0 +1,195 @@
+#pragma once
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include "Framebuffer.hpp"
+#include "Rasterizer.hpp"
+#include "JobSystem.hpp"
+#include "FrameArena.hpp"
+#include "Pipeline.hpp"
+
+// per frame counters and timings of a TileRasterizer
+struct RasterStats {
+    double bin_ms = 0;          // triangle setup and binning
+    double raster_ms = 0;       // clearing and filling every tile, wall clock
+    double slowest_tile_ms = 0;
+    std::size_t triangles = 0;  // triangles covering at least one pixel's bounding box
+    std::size_t tile_refs = 0;  // triangle references across all bins
+};
+
+// multithreaded solid rendering. triangles are set up once and sorted into TILE_SIZE square
+// screen tiles, then each tile is cleared and filled by one job. no two jobs touch the same
+// pixels so the framebuffer and depth buffer need no locking, and the bins are built with a
+// count/prefix sum/scatter over each thread's triangle list so binning needs none either.
+// all per frame storage comes from a FrameArena.
+class TileRasterizer {
+public:
+    static constexpr int TILE_SIZE = 64;
+    static_assert(TILE_SIZE % RASTER_BLOCK == 0);
+
+    TileRasterizer(JobSystem& jobs, int width, int height)
+        : jobs{jobs}, columns{(width + TILE_SIZE - 1) / TILE_SIZE}, rows{(height + TILE_SIZE - 1) / TILE_SIZE},
+          times(static_cast<std::size_t>(columns) * rows) {}
+
+    // clear fb to clear_colour and the far plane, then draw every triangle in triangles
+    void render(Framebuffer& fb, const std::vector<ThreadTriangles>& triangles, uint32_t clear_colour) {
+        using clock = std::chrono::steady_clock;
+        const clock::time_point start = clock::now();
+
+        arena.reset();
+        stats = RasterStats{};
+
+        const std::size_t sources = triangles.size();
+        const std::size_t tiles = times.size();
+        const RasterRect screen {0, 0, fb.width, fb.height};
+
+        // source s's triangles are setups[base[s]] onwards
+        std::size_t* base = arena.allocate<std::size_t>(sources + 1);
+        base[0] = 0;
+        for (std::size_t s = 0; s < sources; s++) {
+            base[s + 1] = base[s] + triangles[s].triangles.size();
+        }
+        TriangleSetup* setups = arena.allocate<TriangleSetup>(base[sources]);
+
+        // counts[s * tiles + t] is how many of source s's triangles land in tile t, later where
+        // the next of them goes in bins
+        uint32_t* counts = arena.allocate<uint32_t>(sources * tiles);
+        std::fill(counts, counts + sources * tiles, 0);
+        std::size_t* valid = arena.allocate<std::size_t>(sources);
+
+        // set up every triangle and count tile overlaps, one job per source list
+        jobs.parallel_for(sources, 1, [&](std::size_t begin, std::size_t end, unsigned) {
+            for (std::size_t src = begin; src < end; src++) {
+                valid[src] = 0;
+                uint32_t* c = counts + src * tiles;
+                const std::vector<ScreenTriangle>& list = triangles[src].triangles;
+                for (std::size_t i = 0; i < list.size(); i++) {
+                    TriangleSetup& s = setups[base[src] + i];
+                    if (!setup_triangle(list[i], screen, s)) {
+                        s.min_x = s.max_x = 0;
+                        continue;
+                    }
+                    valid[src] += 1;
+                    for_each_tile(s, [&](std::size_t tile) {
+                        c[tile] += 1;
+                    });
+                }
+            }
+        });
+
+        // bins laid out tile by tile, within a tile in source order so the output doesn't depend
+        // on scheduling
+        uint32_t* tile_start = arena.allocate<uint32_t>(tiles + 1);
+        uint32_t total = 0;
+        for (std::size_t t = 0; t < tiles; t++) {
+            tile_start[t] = total;
+            for (std::size_t src = 0; src < sources; src++) {
+                const uint32_t n = counts[src * tiles + t];
+                counts[src * tiles + t] = total;
+                total += n;
+            }
+        }
+        tile_start[tiles] = total;
+        uint32_t* bins = arena.allocate<uint32_t>(total);
+
+        jobs.parallel_for(sources, 1, [&](std::size_t begin, std::size_t end, unsigned) {
+            for (std::size_t src = begin; src < end; src++) {
+                uint32_t* cursor = counts + src * tiles;
+                for (std::size_t i = base[src]; i < base[src + 1]; i++) {
+                    if (setups[i].min_x >= setups[i].max_x) {
+                        continue;
+                    }
+                    for_each_tile(setups[i], [&](std::size_t tile) {
+                        bins[cursor[tile]++] = static_cast<uint32_t>(i);
+                    });
+                }
+            }
+        });
+
+        const clock::time_point binned = clock::now();
+
+        jobs.parallel_for(tiles, 1, [&](std::size_t begin, std::size_t end, unsigned) {
+            for (std::size_t t = begin; t < end; t++) {
+                const clock::time_point tile_start_time = clock::now();
+                const RasterRect r = tile_rect(t, fb);
+
+                for (int y = r.y0; y < r.y1; y++) {
+                    const std::size_t row = static_cast<std::size_t>(y) * fb.stride;
+                    std::fill(fb.pixels.begin() + row + r.x0, fb.pixels.begin() + row + r.x1, clear_colour);
+                    std::fill(fb.depth.begin() + row + r.x0, fb.depth.begin() + row + r.x1, static_cast<uint32_t>(DEPTH_MAX));
+                }
+
+                for (uint32_t k = tile_start[t]; k < tile_start[t + 1]; k++) {
+                    TriangleSetup s = setups[bins[k]];
+                    s.min_x = std::max(s.min_x, r.x0);
+                    s.min_y = std::max(s.min_y, r.y0);
+                    s.max_x = std::min(s.max_x, r.x1);
+                    s.max_y = std::min(s.max_y, r.y1);
+                    fill_setup(fb, s);
+                }
+
+                times[t] = std::chrono::duration<double, std::milli>(clock::now() - tile_start_time).count();
+            }
+        });
+
+        const clock::time_point done = clock::now();
+        stats.bin_ms = std::chrono::duration<double, std::milli>(binned - start).count();
+        stats.raster_ms = std::chrono::duration<double, std::milli>(done - binned).count();
+        stats.slowest_tile_ms = *std::max_element(times.begin(), times.end());
+        for (std::size_t src = 0; src < sources; src++) {
+            stats.triangles += valid[src];
+        }
+        stats.tile_refs = total;
+    }
+
+    const RasterStats& raster_stats() const {
+        return stats;
+    }
+
+    // milliseconds spent on each tile during the last render(), row major
+    const std::vector<double>& tile_times() const {
+        return times;
+    }
+
+    int tile_columns() const {
+        return columns;
+    }
+
+    int tile_rows() const {
+        return rows;
+    }
+
+private:
+    JobSystem& jobs;
+    int columns;
+    int rows;
+
+    FrameArena arena;
+    std::vector<double> times;
+    RasterStats stats;
+
+    RasterRect tile_rect(std::size_t tile, const Framebuffer& fb) const {
+        const int tx = static_cast<int>(tile % columns) * TILE_SIZE;
+        const int ty = static_cast<int>(tile / columns) * TILE_SIZE;
+        return RasterRect{tx, ty, std::min(tx + TILE_SIZE, fb.width), std::min(ty + TILE_SIZE, fb.height)};
+    }
+
+    // tiles that s's bounding box overlaps, minus those entirely outside one of its edges
+    template <typename F>
+    void for_each_tile(const TriangleSetup& s, F&& fn) const {
+        const int tx0 = s.min_x / TILE_SIZE;
+        const int ty0 = s.min_y / TILE_SIZE;
+        const int tx1 = std::min((s.max_x - 1) / TILE_SIZE, columns - 1);
+        const int ty1 = std::min((s.max_y - 1) / TILE_SIZE, rows - 1);
+        const bool one_tile = tx0 == tx1 && ty0 == ty1;
+        for (int ty = ty0; ty <= ty1; ty++) {
+            for (int tx = tx0; tx <= tx1; tx++) {
+                if (one_tile || !square_outside(s, tx * TILE_SIZE, ty * TILE_SIZE, TILE_SIZE)) {
+                    fn(static_cast<std::size_t>(ty) * columns + tx);
+                }
+            }
+        }
+    }
+};
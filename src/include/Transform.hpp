@@ -0,0 +1,76 @@
+#pragma once
+#include <cmath>
+#include "Point.hpp"
+#include "Matrix.hpp"
+
+// unit quaternion rotation, w + xi + yj + zk
+template <Numeric N>
+struct Quat {
+    N w;
+    N x;
+    N y;
+    N z;
+
+    Quat(N w, N x, N y, N z) : w{w}, x{x}, y{y}, z{z} {}
+
+    static Quat identity() {
+        return Quat(1, 0, 0, 0);
+    }
+
+    // rotation by angle radians about the unit vector axis, anticlockwise looking down the axis
+    static Quat from_axis_angle(const Point<N>& axis, double angle) {
+        const double s = sin(angle / 2.0);
+        return Quat(static_cast<N>(cos(angle / 2.0)), static_cast<N>(axis.x * s), static_cast<N>(axis.y * s), static_cast<N>(axis.z * s));
+    }
+
+    // rhs first, then this
+    Quat operator*(const Quat& rhs) const {
+        return Quat(
+            w*rhs.w - x*rhs.x - y*rhs.y - z*rhs.z,
+            w*rhs.x + x*rhs.w + y*rhs.z - z*rhs.y,
+            w*rhs.y - x*rhs.z + y*rhs.w + z*rhs.x,
+            w*rhs.z + x*rhs.y - y*rhs.x + z*rhs.w
+        );
+    }
+
+    // back to unit length, composing many rotations slowly drifts away from it
+    Quat normalized() const {
+        const double len = std::sqrt(static_cast<double>(w*w + x*x + y*y + z*z));
+        return Quat(static_cast<N>(w / len), static_cast<N>(x / len), static_cast<N>(y / len), static_cast<N>(z / len));
+    }
+
+    Mat4<N> matrix() const {
+        Mat4<N> r = Mat4<N>::identity();
+        r.m[0][0] = 1 - 2*(y*y + z*z); r.m[0][1] = 2*(x*y - w*z);     r.m[0][2] = 2*(x*z + w*y);
+        r.m[1][0] = 2*(x*y + w*z);     r.m[1][1] = 1 - 2*(x*x + z*z); r.m[1][2] = 2*(y*z - w*x);
+        r.m[2][0] = 2*(x*z - w*y);     r.m[2][1] = 2*(y*z + w*x);     r.m[2][2] = 1 - 2*(x*x + y*y);
+        return r;
+    }
+};
+
+// the rotation make_rotation_matrix builds, as a quaternion
+template <Numeric N>
+Quat<N> make_rotation_quat(double pitch, double yaw) {
+    return Quat<N>::from_axis_angle(Point<N>(0, 1, 0), -yaw) * Quat<N>::from_axis_angle(Point<N>(1, 0, 0), -pitch);
+}
+
+// model -> world placement of a mesh: uniform scale, then rotation, then translation to position
+template <Numeric N>
+struct Transform {
+    Point<N> position {0, 0, 0};
+    Quat<N> rotation = Quat<N>::identity();
+    N scale = 1;
+
+    Mat4<N> matrix() const {
+        Mat4<N> r = rotation.matrix();
+        for (int row = 0; row < 3; row++) {
+            for (int col = 0; col < 3; col++) {
+                r.m[row][col] *= scale;
+            }
+        }
+        r.m[0][3] = position.x;
+        r.m[1][3] = position.y;
+        r.m[2][3] = position.z;
+        return r;
+    }
+};
@@ -1,97 +1,21 @@
 #pragma once
 #include <vector>
+#include <map>
+#include <algorithm>
 #include <tuple>
 #include <utility>
 #include <concepts>
 #include <iostream>
 #include <cmath>
+#include <numbers>
 #include <cstdint>
 #include <cassert>
-
-constexpr double PI = std::numbers::pi;
-
-template<typename N>
-concept Numeric = requires(N n)
-{
-    requires std::is_integral_v<N> || std::is_floating_point_v<N>;
-    requires !std::is_same_v<bool, N>;
-    requires std::is_arithmetic_v<decltype(n + 1)>;
-    requires !std::is_pointer_v<N>;
-};
-
-template <Numeric N>
-struct Point {
-    N x;
-    N y;
-    N z;
-
-    Point(N x, N y, N z) : x{x}, y{y}, z{z} {}
-
-    template <Numeric M>
-    Point(M x, M y, M z) : x{static_cast<N>(x)}, y{static_cast<N>(y)}, z{static_cast<N>(z)} {}
-
-    template <Numeric M>
-    operator Point<M>() const {
-        return Point<M>(
-            static_cast<M>(x),
-            static_cast<M>(y),
-            static_cast<M>(z)
-        );
-    }
-
-    template <Numeric M>
-    Point& operator+=(const Point<M>& rhs) {
-        this->x += static_cast<N>(rhs.x);
-        this->y += static_cast<N>(rhs.y);
-        this->z += static_cast<N>(rhs.z);
-        return *this;
-    }
-
-    template <Numeric M>
-    Point& operator-=(const Point<M>& rhs) {
-        this->x -= static_cast<N>(rhs.x);
-        this->y -= static_cast<N>(rhs.y);
-        this->z -= static_cast<N>(rhs.z);
-        return *this;
-    }
-
-    template <Numeric M>
-    Point& operator*=(const Point<M>& rhs) {
-        this->x *= static_cast<N>(rhs.x);
-        this->y *= static_cast<N>(rhs.y);
-        this->z *= static_cast<N>(rhs.z);
-        return *this;
-    }
-
-    template <Numeric M>
-    friend Point<decltype(std::declval<N>() + std::declval<M>())> operator+(const Point<N>& lhs, const Point<M>& rhs);
-
-    template <Numeric M>
-    friend Point<decltype(std::declval<N>() - std::declval<M>())> operator-(const Point<N>& lhs, const Point<M>& rhs);
-
-    template <Numeric M>
-    friend Point<decltype(std::declval<N>() * std::declval<M>())> operator*(const Point<N>& lhs, const Point<M>& rhs);
-
-    template <Numeric M>
-    friend Point<decltype(std::declval<N>() / std::declval<M>())> operator/(const Point<N>& lhs, const Point<M>& rhs);
-
-    void Display() const {
-        std::cout << "(" << x << "," << y << "," << z << ")";
-    }
-};
-
-template <Numeric N, Numeric M>
-Point<decltype(std::declval<N>() + std::declval<M>())> operator+(const Point<N>& lhs, const Point<M>& rhs) {
-    using O = decltype(std::declval<N>() + std::declval<M>());
-    return Point<O>(lhs.x + rhs.x, lhs.y + rhs.y, lhs.z + rhs.z);
-}
-
-//template <Numeric N, Numeric M>
-template <Numeric N, Numeric M, Numeric O = decltype(std::declval<N>() - std::declval<M>())>
-Point<O> operator+(const Point<N>& lhs, const Point<M>& rhs) {
-    //using O = decltype(std::declval<N>() - std::declval<M>());
-    return Point<O>(lhs.x - rhs.x, lhs.y - rhs.y, lhs.z - rhs.z);
-}
+#include <memory>
+#include "Point.hpp"
+#include "VertexArray.hpp"
+#include "Simd.hpp"
+#include "Bounds.hpp"
+#include "Transform.hpp"
 
 template <Numeric N>
 struct Triangle {
@@ -200,153 +124,304 @@ struct Triangle {
     }
 };
 
+// indices of a triangle's corners in Mesh::verts
+struct Face {
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+};
+
+// a unique edge between two of Mesh::verts, a < b
+struct Edge {
+    uint32_t a;
+    uint32_t b;
+
+    bool operator==(const Edge&) const = default;
+    auto operator<=>(const Edge&) const = default;
+};
+
+template <Numeric N>
+struct IndexedTriangles {
+    std::vector<Point<N>> verts;
+    std::vector<Face> faces;
+};
+
+// collapse the corners of tris into a shared vertex buffer
+template <Numeric N>
+IndexedTriangles<N> index_triangles(const std::vector<Triangle<N>>& tris) {
+    IndexedTriangles<N> r;
+    std::map<std::tuple<N,N,N>, uint32_t> index;
+    const auto lookup = [&](const Point<N>& p) {
+        const auto [it, inserted] = index.try_emplace(std::make_tuple(p.x, p.y, p.z), static_cast<uint32_t>(r.verts.size()));
+        if (inserted) {
+            r.verts.push_back(p);
+        }
+        return it->second;
+    };
+
+    r.faces.reserve(tris.size());
+    for (const Triangle<N>& t : tris) {
+        const uint32_t a = lookup(t.a);
+        const uint32_t b = lookup(t.b);
+        const uint32_t c = lookup(t.c);
+        r.faces.push_back(Face{a, b, c});
+    }
+    return r;
+}
+
+// model space geometry. built once, never modified afterwards and shared by every Mesh drawing it.
+template <Numeric N>
+struct Geometry {
+    // shared vertex buffer, each unique corner is stored (and transformed) once
+    VertexArray<N> verts;
+    std::vector<Face> faces;
+
+    // unique edges of faces, so an edge shared by two triangles is only drawn once
+    std::vector<Edge> edges;
+
+    // the (up to) two faces each edge borders, NO_FACE for the second face of an open edge.
+    // edges shared by more than two faces keep the first two.
+    static constexpr uint32_t NO_FACE = UINT32_MAX;
+    std::vector<std::pair<uint32_t, uint32_t>> edge_faces;
+
+    // unit outward normal of each face, (b - a) x (c - a) normalized
+    std::vector<Point<N>> normals;
+
+    // model space bounding box and sphere
+    Bounds<N> bounds;
+
+    // coarser versions of this geometry, finest first, filled in by build_lods. error is how far
+    // (in model units) a level's surface may stray from this one.
+    struct Lod {
+        std::shared_ptr<const Geometry> geometry;
+        N error;
+    };
+    std::vector<Lod> lods;
+
+    explicit Geometry(const std::vector<Triangle<N>>& tris) : Geometry(index_triangles(tris)) {}
+
+    Geometry(IndexedTriangles<N> indexed) : Geometry(VertexArray<N>(indexed.verts), std::move(indexed.faces)) {}
+
+    Geometry(VertexArray<N> verts, std::vector<Face> faces)
+        : verts{std::move(verts)}, faces{std::move(faces)}
+    {
+        build_edges();
+        compute_normals();
+        bounds = compute_bounds(this->verts);
+    }
+
+    // edges, edge faces and normals already derived from verts and faces (read back from the mesh
+    // cache), only the bounds are computed
+    Geometry(VertexArray<N> verts, std::vector<Face> faces, std::vector<Edge> edges, std::vector<std::pair<uint32_t, uint32_t>> edge_faces, std::vector<Point<N>> normals)
+        : verts{std::move(verts)}, faces{std::move(faces)}, edges{std::move(edges)}, edge_faces{std::move(edge_faces)}, normals{std::move(normals)}
+    {
+        bounds = compute_bounds(this->verts);
+    }
+
+private:
+    void build_edges() {
+        const auto make_edge = [](uint32_t a, uint32_t b) {
+            return a < b ? Edge{a, b} : Edge{b, a};
+        };
+
+        // every face's three edges tagged with the face, sorted so copies of an edge are adjacent
+        std::vector<std::pair<Edge, uint32_t>> tagged;
+        tagged.reserve(faces.size() * 3);
+        for (uint32_t i = 0; i < faces.size(); i++) {
+            const Face& f = faces[i];
+            tagged.emplace_back(make_edge(f.a, f.b), i);
+            tagged.emplace_back(make_edge(f.b, f.c), i);
+            tagged.emplace_back(make_edge(f.c, f.a), i);
+        }
+        std::sort(tagged.begin(), tagged.end());
+
+        edges.clear();
+        edge_faces.clear();
+        for (std::size_t i = 0; i < tagged.size(); i++) {
+            if (!edges.empty() && edges.back() == tagged[i].first) {
+                if (edge_faces.back().second == NO_FACE) {
+                    edge_faces.back().second = tagged[i].second;
+                }
+                continue;
+            }
+            edges.push_back(tagged[i].first);
+            edge_faces.emplace_back(tagged[i].second, NO_FACE);
+        }
+    }
+
+    void compute_normals() {
+        normals.clear();
+        normals.reserve(faces.size());
+        for (const Face& f : faces) {
+            const Point<N> a = verts[f.a];
+            const Point<N> b = verts[f.b];
+            const Point<N> c = verts[f.c];
+            const double ux = static_cast<double>(b.x - a.x), uy = static_cast<double>(b.y - a.y), uz = static_cast<double>(b.z - a.z);
+            const double vx = static_cast<double>(c.x - a.x), vy = static_cast<double>(c.y - a.y), vz = static_cast<double>(c.z - a.z);
+            const double nx = uy*vz - uz*vy;
+            const double ny = uz*vx - ux*vz;
+            const double nz = ux*vy - uy*vx;
+            const double len = std::sqrt(nx*nx + ny*ny + nz*nz);
+            if (len > 0) {
+                normals.push_back(Point<N>(nx / len, ny / len, nz / len));
+            } else {
+                normals.push_back(Point<N>(0, 0, 0));
+            }
+        }
+    }
+};
+
+template <Numeric N>
+using GeometryPtr = std::shared_ptr<const Geometry<N>>;
+
+// a placed copy of some geometry. the geometry stays in model space, moving, turning or scaling a
+// mesh only changes its transform (O(1)) and the renderer folds the transform into the matrix it
+// already multiplies every vertex by.
 template <Numeric N>
 struct Mesh {
-    std::vector<Triangle<N>> tris;
-    Point<N> origin;
+    GeometryPtr<N> geometry;
+    Transform<N> transform;
+
+    // model -> world, transform.matrix() as of the last change
+    Mat4<N> model = Mat4<N>::identity();
+
+    // world space bounding box and sphere, kept up to date by every transform below
+    Bounds<N> bounds;
+
+    // bumped by every change to transform, anything cached per mesh compares against it to
+    // know whether it's stale. setting what's already there is not a change.
+    uint64_t version = 0;
 
     int red = 0, green = 0, blue = 0;
 
     Mesh(std::vector<Triangle<N>> tris)
-        : origin{Point<N>(0,0,0)}, tris{tris} {}
+        : Mesh(std::make_shared<const Geometry<N>>(tris), Point<N>(0,0,0), 1) {}
 
-    Mesh(Point<N> offset, N size, std::vector<Triangle<N>> tris) 
-        : tris{tris}, origin{offset}
-    {
-        for (Triangle<N>& t : this->tris) {
-            t.a.x *= size;
-            t.a.y *= size;
-            t.a.z *= size;
+    Mesh(Point<N> offset, N size, std::vector<Triangle<N>> tris)
+        : Mesh(std::make_shared<const Geometry<N>>(tris), offset, size) {}
+
+    Mesh(Point<N> offset, N size, const std::vector<Point<N>>& verts, std::vector<Face> faces)
+        : Mesh(offset, size, VertexArray<N>(verts), std::move(faces)) {}
 
-            t.b.x *= size;
-            t.b.y *= size;
-            t.b.z *= size;
+    Mesh(Point<N> offset, N size, VertexArray<N> verts, std::vector<Face> faces)
+        : Mesh(std::make_shared<const Geometry<N>>(std::move(verts), std::move(faces)), offset, size) {}
 
-            t.c.x *= size;
-            t.c.y *= size;
-            t.c.z *= size;
+    // another placement of geometry, which is shared and not copied
+    Mesh(GeometryPtr<N> geometry, Point<N> offset, N size)
+        : geometry{std::move(geometry)}
+    {
+        transform.position = offset;
+        transform.scale = size;
+        changed();
+    }
 
-            t.a.x += origin.x;
-            t.a.y += origin.y;
-            t.a.z += origin.z;
+    const Point<N>& origin() const {
+        return transform.position;
+    }
 
-            t.b.x += origin.x;
-            t.b.y += origin.y;
-            t.b.z += origin.z;
+    std::size_t triangle_count() const {
+        return geometry->faces.size();
+    }
 
-            t.c.x += origin.x;
-            t.c.y += origin.y;
-            t.c.z += origin.z;
-        }
+    // face i in world space
+    Triangle<N> triangle(std::size_t i) const {
+        const Face& f = geometry->faces[i];
+        const auto world = [&](uint32_t v) {
+            const Vec4<N> p = model.transform(geometry->verts[v]);
+            return Point<N>(p.x, p.y, p.z);
+        };
+        return Triangle<N>(world(f.a), world(f.b), world(f.c));
     }
 
     template <Numeric M = N>
     void set_origin(const Point<M>& p) {
-        const Point<N> pN = static_cast<Point<N>>(p);
-
-        // calculate change
-        Point<N> translation = pN;
-        translation -= origin;
-
-        origin = pN;
-        for (Triangle<N>& t : tris) {
-            t += translation;
+        const Point<N> q = static_cast<Point<N>>(p);
+        if (q == transform.position) {
+            return;
         }
+        transform.position = q;
+        changed();
     }
 
     template <Numeric M = N>
     void translate(const Point<M>& p) {
-        const Point<N> pN = static_cast<Point<N>>(p);
-        for (Triangle<N>& t : tris) {
-            t += pN;
+        if (static_cast<Point<N>>(p) == Point<N>(0, 0, 0)) {
+            return;
         }
-        origin += pN;
+        transform.position += static_cast<Point<N>>(p);
+        changed();
     }
 
+    // about origin
     template <Numeric M = N>
     void scale(M s) {
-        const N sN = static_cast<N>(s);
-        for (Triangle<N>& t : tris) {
-            t -= origin;
-            t *= Point<N>(sN,sN,sN);
-            t += origin;
+        if (static_cast<N>(s) == 1) {
+            return;
         }
+        transform.scale *= static_cast<N>(s);
+        changed();
     }
 
+    // about origin, on top of any earlier rotation
     void rotate(double pitch, double yaw, double roll) {
-        for (Triangle<N>& t : this->tris) {
-
-            t -= this->origin;
-
-            // pitch
-            double r_zy = 0.0;
-            double a0_zy = 0.0;
-            r_zy = sqrtl(powl(t.a.z, 2) + powl(t.a.y, 2));
-            a0_zy = atan2l(t.a.y, t.a.z);
-            t.a.z = r_zy * cosl(a0_zy + pitch);
-            t.a.y = r_zy * sinl(a0_zy + pitch);
-
-            r_zy = sqrtl(powl(t.b.z, 2) + powl(t.b.y, 2));
-            a0_zy = atan2l(t.b.y, t.b.z);
-            t.b.z = r_zy * cosl(a0_zy + pitch);
-            t.b.y = r_zy * sinl(a0_zy + pitch);
-
-            r_zy = sqrtl(powl(t.c.z, 2) + powl(t.c.y, 2));
-            a0_zy = atan2l(t.c.y, t.c.z);
-            t.c.z = r_zy * cosl(a0_zy + pitch);
-            t.c.y = r_zy * sinl(a0_zy + pitch);
-
-            // yaw
-            double r_xz = 0.0;
-            double a0_xz = 0.0;
-
-            r_xz = sqrtl(powl(t.a.x, 2) + powl(t.a.z, 2));
-            a0_xz = atan2l(t.a.z, t.a.x);
-            t.a.x = r_xz * cosl(a0_xz + yaw);
-            t.a.z = r_xz * sinl(a0_xz + yaw);
-
-            r_xz = sqrtl(powl(t.b.x, 2) + powl(t.b.z, 2));
-            a0_xz = atan2l(t.b.z, t.b.x);
-            t.b.x = r_xz * cosl(a0_xz + yaw);
-            t.b.z = r_xz * sinl(a0_xz + yaw);
-
-            r_xz = sqrtl(powl(t.c.x, 2) + powl(t.c.z, 2));
-            a0_xz = atan2l(t.c.z, t.c.x);
-            t.c.x = r_xz * cosl(a0_xz + yaw);
-            t.c.z = r_xz * sinl(a0_xz + yaw);
-
-            t += this->origin;
+        if (pitch == 0 && yaw == 0) {
+            return;
         }
+        transform.rotation = (make_rotation_quat<N>(pitch, yaw) * transform.rotation).normalized();
+        changed();
+    }
+
+    void set_rotation(const Quat<N>& q) {
+        transform.rotation = q.normalized();
+        changed();
+    }
+
+private:
+    void changed() {
+        model = transform.matrix();
+        bounds = transform_bounds(geometry->bounds, model, transform.scale);
+        version += 1;
     }
 };
 
+// unit cube, every cube shares one geometry
 template <Numeric N>
 Mesh<N> MakeCube(Point<N> origin, N scale) {
-    return Mesh<N> (origin, scale, std::vector<Triangle<N>> {
+    static const GeometryPtr<N> cube = std::make_shared<const Geometry<N>>(VertexArray<N>(std::vector<Point<N>> {
+        Point<N>(-0.5f,-0.5f,-0.5f), // 0
+        Point<N>(-0.5f,0.5f,-0.5f),  // 1
+        Point<N>(0.5f,0.5f,-0.5f),   // 2
+        Point<N>(0.5f,-0.5f,-0.5f),  // 3
+        Point<N>(0.5f,0.5f,0.5f),    // 4
+        Point<N>(0.5f,-0.5f,0.5f),   // 5
+        Point<N>(-0.5f,0.5f,0.5f),   // 6
+        Point<N>(-0.5f,-0.5f,0.5f),  // 7
+    }), std::vector<Face> {
         // south
-        Triangle<N>(Point<N>(-0.5f,-0.5f,-0.5f), Point<N>(-0.5f,0.5f,-0.5f), Point<N>(0.5f,0.5f,-0.5f)),
-        Triangle<N>(Point<N>(0.5f,-0.5f,-0.5f), Point<N>(-0.5f,-0.5f,-0.5f), Point<N>(0.5f,0.5f,-0.5f)),
+        Face{0, 1, 2},
+        Face{3, 0, 2},
 
         // east
-        Triangle<N>(Point<N>(0.5f,-0.5f,-0.5f), Point<N>(0.5f,0.5f,-0.5f), Point<N>(0.5f,0.5f,0.5f)),
-        Triangle<N>(Point<N>(0.5f,-0.5f,-0.5f), Point<N>(0.5f,0.5f,0.5f), Point<N>(0.5f,-0.5f,0.5f)),
+        Face{3, 2, 4},
+        Face{3, 4, 5},
 
         // north
-        Triangle<N>(Point<N>(0.5f,-0.5f,0.5f), Point<N>(0.5f,0.5f,0.5f), Point<N>(-0.5f,0.5f,0.5f)),
-        Triangle<N>(Point<N>(0.5f,-0.5f,0.5f), Point<N>(-0.5f,0.5f,0.5f), Point<N>(-0.5f,-0.5f,0.5f)),
+        Face{5, 4, 6},
+        Face{5, 6, 7},
 
         // west
-        Triangle<N>(Point<N>(-0.5f,-0.5f,0.5f), Point<N>(-0.5f,0.5f,0.5f), Point<N>(-0.5f,0.5f,-0.5f)),
-        Triangle<N>(Point<N>(-0.5f,-0.5f,0.5f), Point<N>(-0.5f,0.5f,-0.5f), Point<N>(-0.5f,-0.5f,-0.5f)),
+        Face{7, 6, 1},
+        Face{7, 1, 0},
 
         // top
-        Triangle<N>(Point<N>(-0.5f,0.5f,-0.5f), Point<N>(-0.5f,0.5f,0.5f), Point<N>(0.5f,0.5f,0.5f)),
-        Triangle<N>(Point<N>(-0.5f,0.5f,-0.5f), Point<N>(0.5f,0.5f,0.5f), Point<N>(0.5f,0.5f,-0.5f)),
+        Face{1, 6, 4},
+        Face{1, 4, 2},
 
-        // bottomN
-        Triangle<N>(Point<N>(0.5f,-0.5f,0.5f), Point<N>(-0.5f,-0.5f,0.5f), Point<N>(-0.5f,-0.5f,-0.5f)),
-        Triangle<N>(Point<N>(0.5f,-0.5f,0.5f), Point<N>(-0.5f,-0.5f,-0.5f), Point<N>(0.5f,-0.5f,-0.5f)),
+        // bottom
+        Face{5, 7, 0},
+        Face{5, 0, 3},
     });
+    return Mesh<N>(cube, origin, scale);
 }
 
 /*template <Numeric N>
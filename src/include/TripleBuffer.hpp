@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+
+// hands the newest value from one producer thread to one consumer thread without locks or
+// waiting. of the three slots the producer owns one to write into, the consumer owns one to read
+// from, and the third is the latest finished value. publish() and read() each swap their own slot
+// with that one, so neither side ever sees a value the other is still working on. values the
+// consumer was too slow to read are skipped, it always gets the newest.
+template <typename T>
+class TripleBuffer {
+public:
+    // producer only, the slot to fill before publish(). holds whatever it held two publishes ago.
+    T& write_slot() {
+        return slots[back].value;
+    }
+
+    // producer only, makes write_slot() the newest value
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // consumer only, the newest published value. stays valid and unchanged until the next read().
+    const T& read() {
+        if (middle.load(std::memory_order_relaxed) & FRESH) {
+            front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        }
+        return slots[front].value;
+    }
+
+private:
+    // set in middle when it holds a value the consumer hasn't taken yet
+    static constexpr unsigned FRESH = 4;
+    static constexpr unsigned INDEX = 3;
+
+    // each slot on its own cache lines so the two threads don't share any
+    struct alignas(64) Slot {
+        T value {};
+    };
+
+    Slot slots[3];
+    std::atomic<unsigned> middle {1};
+    alignas(64) unsigned back = 0;
+    alignas(64) unsigned front = 2;
+};
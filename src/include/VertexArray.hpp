@@ -0,0 +1,143 @@
+#pragma once
+#include <vector>
+#include <new>
+#include <cstddef>
+#include "Point.hpp"
+#include "Matrix.hpp"
+
+// widest vector register we have kernels for (AVX, 32 bytes)
+constexpr std::size_t SIMD_ALIGN = 32;
+
+template <typename T, std::size_t Align>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Align>;
+    };
+
+    AlignedAllocator() = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Align>&) {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{Align}));
+    }
+
+    void deallocate(T* p, std::size_t) {
+        ::operator delete(p, std::align_val_t{Align});
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Align>&) const {
+        return true;
+    }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T, SIMD_ALIGN>>;
+
+// round count up to a whole number of vector registers of T
+template <typename T>
+constexpr std::size_t simd_padded(std::size_t count) {
+    constexpr std::size_t lanes = SIMD_ALIGN / sizeof(T);
+    return (count + lanes - 1) / lanes * lanes;
+}
+
+// structure-of-arrays vertex storage. each component array is aligned and padded to a whole
+// vector register so kernels never need a scalar tail, padding lanes hold unspecified values.
+template <Numeric N>
+struct VertexArray {
+    AlignedVector<N> x;
+    AlignedVector<N> y;
+    AlignedVector<N> z;
+
+    std::size_t count = 0;
+
+    VertexArray() = default;
+
+    VertexArray(const std::vector<Point<N>>& points) {
+        reserve(points.size());
+        for (const Point<N>& p : points) {
+            push_back(p);
+        }
+    }
+
+    std::size_t size() const {
+        return count;
+    }
+
+    std::size_t padded_size() const {
+        return x.size();
+    }
+
+    void reserve(std::size_t n) {
+        x.reserve(simd_padded<N>(n));
+        y.reserve(simd_padded<N>(n));
+        z.reserve(simd_padded<N>(n));
+    }
+
+    void resize(std::size_t n) {
+        count = n;
+        x.resize(simd_padded<N>(n));
+        y.resize(simd_padded<N>(n));
+        z.resize(simd_padded<N>(n));
+    }
+
+    void clear() {
+        resize(0);
+    }
+
+    void push_back(const Point<N>& p) {
+        const std::size_t i = count;
+        if (i == x.size()) {
+            resize(i + 1);
+        } else {
+            count += 1;
+        }
+        set(i, p);
+    }
+
+    Point<N> operator[](std::size_t i) const {
+        return Point<N>(x[i], y[i], z[i]);
+    }
+
+    void set(std::size_t i, const Point<N>& p) {
+        x[i] = p.x;
+        y[i] = p.y;
+        z[i] = p.z;
+    }
+};
+
+// window space depth is fixed point, normalized z in [0, 1] scaled to [0, DEPTH_MAX]
+constexpr int DEPTH_BITS = 24;
+constexpr int DEPTH_MAX = (1 << DEPTH_BITS) - 1;
+
+template <Numeric N>
+int depth_to_fixed(N z) {
+    return static_cast<int>(static_cast<double>(z) * DEPTH_MAX);
+}
+
+// window space positions, x and y in pixels and z the normalized depth. operator[] gives z in the
+// fixed point form scale_point_to_win uses.
+template <Numeric N>
+struct ScreenArray {
+    AlignedVector<int> x;
+    AlignedVector<int> y;
+    AlignedVector<N> z;
+
+    std::size_t count = 0;
+
+    void resize(std::size_t n) {
+        count = n;
+        x.resize(simd_padded<N>(n));
+        y.resize(simd_padded<N>(n));
+        z.resize(simd_padded<N>(n));
+    }
+
+    Point<int> operator[](std::size_t i) const {
+        return Point<int>(x[i], y[i], depth_to_fixed(z[i]));
+    }
+};
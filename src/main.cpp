@@ -6,103 +6,406 @@
 #include <cmath>
 #include <algorithm>
 #include <optional>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <vector>
+#include <array>
+#include <thread>
+#include <atomic>
 #include <SDL.h>
 #include "include/Triangle.hpp"
+#include "include/Fixed.hpp"
 #include "include/CohenSutherlandClip.hpp"
+#include "include/Camera.hpp"
+#include "include/JobSystem.hpp"
+#include "include/Pipeline.hpp"
+#include "include/LineBatch.hpp"
+#include "include/Scene.hpp"
+#include "include/SceneLoader.hpp"
+#include "include/RenderBackend.hpp"
+#include "include/SdlBackend.hpp"
+#include "include/SoftwareBackend.hpp"
+#include "include/Framebuffer.hpp"
+#include "include/TileRasterizer.hpp"
+#include "include/Profiler.hpp"
+#include "include/ProfileOverlay.hpp"
+#include "include/FramePacer.hpp"
+#include "include/AllocationCounter.hpp"
+#include "include/TripleBuffer.hpp"
+#include "include/SpscRing.hpp"
 
 constexpr int WIN_WIDTH = 1080;
 constexpr int WIN_HEIGHT = 720;
+// number type of geometry and the pipeline, make PRECISION=float or PRECISION=fixed picks the
+// others. the simulation and camera stay in double either way.
+#if defined(ENGINE_FIXED)
+using Real = Fixed;
+#elif defined(ENGINE_FLOAT)
+using Real = float;
+#else
+using Real = double;
+#endif
+
 constexpr double WIN_ASPECT_RATIO = static_cast<double>(WIN_WIDTH) / static_cast<double>(WIN_HEIGHT);
 constexpr std::string WIN_TITLE ("Nick's Window");
+constexpr std::size_t TITLE_CAPACITY = 256; // window title with the frame counters
 
 //constexpr double PI = std::numbers::pi;
 constexpr double CAM_FOV = PI/2.0;
 constexpr double CAM_DIST = 1.0;
-constexpr double CAM_GAP = 0.1;
-
-void project_point(Point<double>& p, const Point<double>& player, double camera) {
-
-    // normalize x
-    const double xFar = player.x + CAM_DIST;
-    const double xNear = player.x + CAM_GAP;
-    const double x_normalized = p.x * cosl(camera)*(xFar/(xFar-xNear)) - (xFar*xNear/(xFar-xNear));
-
-    // normalize z
-    const double zFar = player.z + CAM_DIST;
-    const double zNear = player.z + CAM_GAP;
-    const double z_normalized = p.z * (zFar/(zFar-zNear)) - (zFar*zNear/(zFar-zNear));
-
-    // project x and y into orthographic perspective (?)
-    const double f = 1.0 / tanl(CAM_FOV / 2.0);
-    const double x_projected = f * p.x;
-    const double y_projected = f * p.y;
-    
-    //p.x = WIN_ASPECT_RATIO * x_projected / p.z;
-    p.x = x_projected / p.z;
-    p.y = y_projected / p.z;
-    p.z = p.z;
-
-}
+constexpr double CAM_GAP = 0.1; // near plane
+constexpr double CAM_FAR = 100.0;
 
-Point<int> scale_point_to_win(const Point<double>& p) {
-    return Point<int> (
-        (WIN_WIDTH/2.0) * p.x + (WIN_WIDTH/2.0),
-        WIN_HEIGHT - ((WIN_HEIGHT/2.0) * p.y + (WIN_HEIGHT/2.0)), // flip vertically
-        p.z
-    );
-}
+// the simulation runs at a fixed rate whatever the frame rate. movement is per second of held key.
+constexpr double SIM_HZ = 120.0;
+constexpr double MOVE_SPEED = 1.5;
+constexpr double TURN_SPEED = 1.5;
+constexpr double HEADLESS_TURN = 0.01; // per step, a headless run steps once per frame
 
 double fix_angle(double angle) {
     if (angle < 0) {
         return angle = 2*PI + angle;
     } else if (angle > 2*PI) {
-        angle = fmodl(angle, 2.0*PI);
+        angle = std::fmod(angle, 2.0*PI);
     }
     return angle;
 }
 
+// everything the fixed timestep simulation advances
+struct PlayerState {
+    Point<double> position {0.0, 0.0, 0.0};
+    double camera = 0.0; // facing east
+};
+
+// one fixed step. keys says which keys are held by scancode, nullptr for a headless run which just
+// turns.
+void simulate(PlayerState& s, const Uint8* keys, double dt) {
+    if (!keys) {
+        s.camera = fix_angle(s.camera + HEADLESS_TURN);
+        return;
+    }
+    const auto walk = [&](double direction) {
+        s.position.x += MOVE_SPEED * dt * std::cos(fix_angle(s.camera + direction));
+        s.position.z -= MOVE_SPEED * dt * std::sin(fix_angle(s.camera + direction));
+    };
+    if (keys[SDL_SCANCODE_W]) {
+        walk(0.0);
+    }
+    if (keys[SDL_SCANCODE_S]) {
+        walk(PI);
+    }
+    if (keys[SDL_SCANCODE_A]) {
+        walk(-PI/2.0);
+    }
+    if (keys[SDL_SCANCODE_D]) {
+        walk(PI/2.0);
+    }
+    if (keys[SDL_SCANCODE_RIGHT]) {
+        s.camera = fix_angle(s.camera + TURN_SPEED * dt);
+    }
+    if (keys[SDL_SCANCODE_LEFT]) {
+        s.camera = fix_angle(s.camera - TURN_SPEED * dt);
+    }
+}
+
+// alpha of the way from a to b, the camera turning the short way round
+PlayerState interpolate(const PlayerState& a, const PlayerState& b, double alpha) {
+    double turn = b.camera - a.camera;
+    if (turn > PI) {
+        turn -= 2*PI;
+    } else if (turn < -PI) {
+        turn += 2*PI;
+    }
+    PlayerState r;
+    r.position = Point<double>(
+        a.position.x + (b.position.x - a.position.x) * alpha,
+        a.position.y + (b.position.y - a.position.y) * alpha,
+        a.position.z + (b.position.z - a.position.z) * alpha
+    );
+    r.camera = fix_angle(a.camera + turn * alpha);
+    return r;
+}
+
+// a key going down or up, from the event loop to the simulation thread. at is when it happened,
+// time spent queued in SDL included. release_all lets go of every key instead, it starts a
+// resync after the queue overflowed (see queue_held_keys()).
+struct InputEvent {
+    SDL_Scancode key;
+    bool down;
+    std::chrono::steady_clock::time_point at;
+    bool release_all = false;
+};
+
+constexpr std::size_t INPUT_QUEUE = 256;
+constexpr std::size_t MAX_LATENCY_SAMPLES = 4096;
+
+// what the simulation thread hands the renderer after each batch of steps
+struct SimSnapshot {
+    PlayerState previous;
+    PlayerState current;
+    std::chrono::steady_clock::time_point stepped; // when current was reached
+    std::chrono::steady_clock::time_point newest_input; // of the input applied so far
+};
+
+// a key change the queue had no room for can't be dropped, a lost key up would leave that key
+// held on the simulation thread. instead the event loop tracks what's held itself and, once there
+// is room, has the simulation let go of everything and press again what's still held. false when
+// that didn't fit either, it's retried the next frame, a partial resync is undone by the next one.
+template <std::size_t CAPACITY>
+bool queue_held_keys(SpscRing<InputEvent, CAPACITY>& input, const std::array<Uint8, SDL_NUM_SCANCODES>& held) {
+    if (!input.push(InputEvent{SDL_SCANCODE_UNKNOWN, false, {}, true})) {
+        return false;
+    }
+    for (std::size_t key = 0; key < held.size(); key++) {
+        if (held[key] && !input.push(InputEvent{static_cast<SDL_Scancode>(key), true, {}})) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the simulation of an interactive run, on its own thread so slow frames don't hold up input
+// and input doesn't hold up frames. key changes queued by the event loop are applied, the player
+// advances in fixed steps at SIM_HZ and every batch of steps is published for the renderer.
+void run_simulation(SpscRing<InputEvent, INPUT_QUEUE>& input, TripleBuffer<SimSnapshot>& out, const std::atomic<bool>& stop) {
+    using clock = std::chrono::steady_clock;
+    FixedTimestep timestep (1.0 / SIM_HZ);
+    const auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(timestep.step_seconds()));
+
+    std::array<Uint8, SDL_NUM_SCANCODES> keys {};
+    SimSnapshot state;
+    auto last = clock::now();
+    auto next = last + period;
+    while (!stop.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_until(next);
+        next += period;
+
+        input.drain([&](const InputEvent& e) {
+            if (e.release_all) {
+                keys.fill(0);
+            } else if (e.key >= 0 && static_cast<std::size_t>(e.key) < keys.size()) {
+                keys[e.key] = e.down;
+            }
+            state.newest_input = std::max(state.newest_input, e.at);
+        });
+
+        const auto now = clock::now();
+        const int steps = timestep.advance(std::chrono::duration<double>(now - last).count());
+        last = now;
+        for (int i = 0; i < steps; i++) {
+            state.previous = state.current;
+            simulate(state.current, keys.data(), timestep.step_seconds());
+        }
+        if (steps > 0) {
+            state.stepped = now;
+            out.write_slot() = state;
+            out.publish();
+        }
+
+        // too far behind to catch up, start the schedule over
+        if (now - next > period * FixedTimestep::MAX_STEPS) {
+            next = now + period;
+        }
+    }
+}
+
+// mean, p99 and max of the input to present latencies in ms, nothing if there were none
+void write_latency_report(std::ostream& out, std::vector<double> ms) {
+    if (ms.empty()) {
+        return;
+    }
+    std::sort(ms.begin(), ms.end());
+    double sum = 0;
+    for (double m : ms) {
+        sum += m;
+    }
+    out << "input to present latency " << sum / ms.size() << " ms mean, "
+        << ms[static_cast<std::size_t>(std::ceil(0.99 * ms.size())) - 1] << " ms p99, "
+        << ms.back() << " ms max over " << ms.size() << " inputs" << std::endl;
+}
+
+// command line: [models.csv] [--headless FRAMES] [--dump FILE.ppm] [--solid | --hidden-line] [--lod-bias B]
+// [--vsync | --fps N | --uncapped] [--profile-overlay] [--trace FILE.json] [--profile-csv FILE.csv]
+// [--check-allocations]. the profiling options need a build with ENGINE_PROFILE and
+// --check-allocations one with ENGINE_COUNT_ALLOCATIONS. headless runs are always uncapped.
+struct Options {
+    std::string models = "models.csv";
+    long long headless_frames = 0; // 0 opens a window
+    std::string dump_path;
+    RenderMode mode = RenderMode::WIREFRAME;
+    double lod_bias = 0;
+    PacingMode pacing = PacingMode::VSYNC;
+    double target_fps = 60.0;
+    bool profile_overlay = false;
+    std::string trace_path;
+    std::string profile_csv_path;
+    bool check_allocations = false;
+};
+
+constexpr const char* USAGE = " [models.csv] [--headless FRAMES] [--dump FILE.ppm] [--solid | --hidden-line] [--lod-bias B]"
+    " [--vsync | --fps N | --uncapped] [--profile-overlay] [--trace FILE.json] [--profile-csv FILE.csv]"
+    " [--check-allocations]";
+
+std::optional<Options> parse_options(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--headless" && i + 1 < argc) {
+            options.headless_frames = std::atoll(argv[++i]);
+            if (options.headless_frames <= 0) {
+                std::cerr << "--headless needs a positive frame count" << std::endl;
+                return std::nullopt;
+            }
+        } else if (arg == "--dump" && i + 1 < argc) {
+            options.dump_path = argv[++i];
+        } else if (arg == "--solid") {
+            options.mode = RenderMode::SOLID;
+        } else if (arg == "--hidden-line") {
+            options.mode = RenderMode::HIDDEN_LINE;
+        } else if (arg == "--lod-bias" && i + 1 < argc) {
+            options.lod_bias = std::atof(argv[++i]);
+        } else if (arg == "--vsync") {
+            options.pacing = PacingMode::VSYNC;
+        } else if (arg == "--fps" && i + 1 < argc) {
+            options.pacing = PacingMode::TARGET_FPS;
+            options.target_fps = std::atof(argv[++i]);
+            if (options.target_fps <= 0) {
+                std::cerr << "--fps needs a positive frame rate" << std::endl;
+                return std::nullopt;
+            }
+        } else if (arg == "--uncapped") {
+            options.pacing = PacingMode::UNCAPPED;
+        } else if (arg == "--profile-overlay") {
+            options.profile_overlay = true;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            options.trace_path = argv[++i];
+        } else if (arg == "--profile-csv" && i + 1 < argc) {
+            options.profile_csv_path = argv[++i];
+        } else if (arg == "--check-allocations") {
+            options.check_allocations = true;
+        } else if (arg.starts_with("--")) {
+            std::cerr << "Usage: " << argv[0] << USAGE << std::endl;
+            return std::nullopt;
+        } else {
+            options.models = arg;
+        }
+    }
+    return options;
+}
+
 int main(int argc, char* argv[]) {
-    // initialize SDL
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-        std::cerr << "SDL initialization failed: " << SDL_GetError() << std::endl;
+    const std::optional<Options> options = parse_options(argc, argv);
+    if (!options) {
         return 1;
     }
-
-    // create a window
-    SDL_Window* window = SDL_CreateWindow(WIN_TITLE.c_str(), SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WIN_WIDTH, WIN_HEIGHT, SDL_WINDOW_SHOWN);
-    if (!window) {
-        std::cerr << "Window creation failed: " << SDL_GetError() << std::endl;
-        SDL_Quit();
+    const bool headless = options->headless_frames > 0;
+#ifndef ENGINE_PROFILE
+    if (options->profile_overlay || !options->trace_path.empty() || !options->profile_csv_path.empty()) {
+        std::cerr << "Profiling options need a build with ENGINE_PROFILE (make PROFILE=1)" << std::endl;
         return 1;
     }
-
-    // create a renderer for the window
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-    if (!renderer) {
-        std::cerr << "Renderer creation failed: " << SDL_GetError() << std::endl;
-        SDL_DestroyWindow(window);
-        SDL_Quit();
+#endif
+#ifndef ENGINE_COUNT_ALLOCATIONS
+    if (options->check_allocations) {
+        std::cerr << "--check-allocations needs a build with ENGINE_COUNT_ALLOCATIONS (make check-allocations)" << std::endl;
+        return 1;
+    }
+#endif
+    // the first full turn of the camera warms up every buffer to the largest frame it will see,
+    // the frames after it repeat the same views and must not allocate
+    const long long warmup_frames = static_cast<long long>(std::ceil(2*PI / HEADLESS_TURN));
+    if (options->check_allocations && options->headless_frames <= warmup_frames) {
+        std::cerr << "--check-allocations needs a headless run of more than " << warmup_frames << " frames" << std::endl;
         return 1;
     }
 
-    //Point<double> camera = Point<double>(0,0,0);
-    Mesh<double> cube = MakeCube<double>(Point<double>(0.5,0.0,0.0), 0.2); // east
-    cube.red = 255; 
-
+    // without a display everything is drawn into a framebuffer in memory
+    std::unique_ptr<RenderBackend> backend;
+    SoftwareBackend* software = nullptr;
+    if (headless) {
+        auto b = std::make_unique<SoftwareBackend>(WIN_WIDTH, WIN_HEIGHT);
+        software = b.get();
+        backend = std::move(b);
+    } else {
+        backend = SdlBackend::create(WIN_TITLE, WIN_WIDTH, WIN_HEIGHT, options->pacing == PacingMode::VSYNC);
+        if (!backend) {
+            return 1;
+        }
+    }
 
-    Mesh<double> cube2 = MakeCube<double>(Point<double>(0.5,0.0,0.0), 0.05);
+    //Point<double> camera = Point<double>(0,0,0);
+    Mesh<Real> cube2 = MakeCube<Real>(Point<Real>(0.5,0.0,0.0), 0.05);
     cube2.green = 255;
 
-    std::vector<Mesh<double>> meshes {cube, cube2};
+    Scene<Real> scene;
+    const Scene<Real>::MeshId pointer = scene.add(cube2);
+
+    // the rest of the scene streams in from models.csv (or the file given as the first argument)
+    // while we render. a headless run waits for all of it so every frame draws the same scene.
+    SceneLoader<Real> loader (options->models);
+    if (headless) {
+        loader.wait(scene);
+    }
 
     // main loop
     bool quit = false;
     int tick = 0;
 
-    double camera = 0.0; // facing east
-    Point<double> player (0.0, 0.0, 0.0);
+    // an interactive run simulates on its own thread and each frame draws the newest snapshot
+    // it published. a headless run steps inline once per frame so its frames don't depend on
+    // how fast they're drawn.
+    FixedTimestep timestep (1.0 / SIM_HZ);
+    PlayerState current; // headless only
+    SpscRing<InputEvent, INPUT_QUEUE> input;
+    std::array<Uint8, SDL_NUM_SCANCODES> held {}; // keys down as the event loop saw them
+    bool resync_keys = false; // a key change was dropped, see queue_held_keys()
+    TripleBuffer<SimSnapshot> snapshots;
+    std::atomic<bool> stop_simulation {false};
+    std::thread simulation;
+    if (!headless) {
+        simulation = std::thread([&] { run_simulation(input, snapshots, stop_simulation); });
+    }
+
+    // input to present latency, from a key changing to the first frame presented with a
+    // simulation step that applied it
+    std::vector<double> latencies;
+    latencies.reserve(MAX_LATENCY_SAMPLES);
+    std::chrono::steady_clock::time_point last_input_shown {};
+
+    const Viewport viewport {WIN_WIDTH, WIN_HEIGHT};
+
+    // transform and clipping is spread over a worker pool, only backend calls stay on this thread
+    JobSystem jobs;
+    FramePipeline<Real> pipeline (jobs);
+    pipeline.set_render_mode(options->mode);
+    pipeline.set_lod_bias(options->lod_bias);
+
+    // wireframe goes to the backend as line batches, solid mode is rasterized on the cpu into
+    // its own colour/depth buffer which is then handed to the backend whole
+    LineBatch batch;
+    LineBatch overlay;
+    bool show_overlay = options->profile_overlay;
+    Framebuffer solid (WIN_WIDTH, WIN_HEIGHT);
+    TileRasterizer tiles (jobs, WIN_WIDTH, WIN_HEIGHT);
+
+    // raster timings summed over the solid frames of a headless run
+    RasterStats raster_total;
+    std::vector<double> tile_total (tiles.tile_times().size());
+    long long solid_frames = 0;
+    long long reused_frames = 0; // frames that drew nothing new, see FramePipeline::reused_last_frame()
+    std::string last_title;
+    last_title.reserve(TITLE_CAPACITY);
+
+    FramePacer pacer (headless ? PacingMode::UNCAPPED : options->pacing, options->target_fps);
+    const auto started = std::chrono::steady_clock::now();
+
+    // heap allocations made by the frames after the warm up
+    std::size_t steady_allocations = 0;
+    long long allocating_frames = 0;
 
     while (!quit) {
+        const std::size_t allocations_before = heap_allocations();
         //player.Display();
         //std::cout << '\t';
         //std::cout << "" << camera << " (" << (camera/PI) * 180 << ")";
@@ -110,137 +413,234 @@ int main(int argc, char* argv[]) {
         //cube.origin.Display();
         //std::cout << '\n';
 
-        // player distance from world origin
-        const double r0 = sqrtl(pow(player.x,2) + pow(player.z,2)); 
-
-        // handle events on queue
-        SDL_Event e;
-        while (SDL_PollEvent(&e)) {
-            // user requests quit
-            if (e.type == SDL_QUIT) {
-                quit = true;
-            } else if (e.type == SDL_KEYDOWN) {
-                // select surfaces based on key press
-                switch (e.key.keysym.sym) {
-                    case SDLK_q: 
-                        quit = true;
-                        break;
-                    case SDLK_a:
-                        player.x += 0.05 * cosl(fix_angle(camera - PI/2.0));
-                        player.z -= 0.05 * sinl(fix_angle(camera - PI/2.0));
-                        break;
-                    case SDLK_d:
-                        player.x += 0.05 * cosl(fix_angle(camera + PI/2.0));
-                        player.z -= 0.05 * sinl(fix_angle(camera + PI/2.0));
-                        break;
-                    case SDLK_w:
-                        player.x += 0.05 * cosl(fix_angle(camera));
-                        player.z -= 0.05 * sinl(fix_angle(camera));
-                        break;
-                    case SDLK_s:
-                        player.x += 0.05 * cosl(fix_angle(camera + PI));
-                        player.z -= 0.05 * sinl(fix_angle(camera + PI));
-                        break;
-                    case SDLK_RIGHT: 
-                        camera = fix_angle(camera + 0.05);
-                        break;
-                    case SDLK_LEFT: 
-                        camera = fix_angle(camera - 0.05);
-                        break;
-                    case SDLK_UP: 
-                        break;
-                    case SDLK_DOWN: 
-                        break;
-                    default:
-                        break;
+        // handle events on queue, only toggles are handled here. key changes go to the simulation
+        // thread, which tracks what's held so movement doesn't depend on key repeat.
+        {
+            PROFILE_SCOPE("events");
+            SDL_Event e;
+            while (!headless && SDL_PollEvent(&e)) {
+                if ((e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) && !e.key.repeat) {
+                    // SDL stamps events in milliseconds when they're queued
+                    const auto queued = std::chrono::milliseconds(SDL_GetTicks() - e.key.timestamp);
+                    const InputEvent change {e.key.keysym.scancode, e.type == SDL_KEYDOWN, std::chrono::steady_clock::now() - queued};
+                    if (change.key >= 0 && static_cast<std::size_t>(change.key) < held.size()) {
+                        held[change.key] = change.down;
+                    }
+                    if (!resync_keys && !input.push(change)) {
+                        resync_keys = true;
+                    }
+                }
+                // user requests quit
+                if (e.type == SDL_QUIT) {
+                    quit = true;
+                } else if (e.type == SDL_KEYDOWN && !e.key.repeat) {
+                    // select surfaces based on key press
+                    switch (e.key.keysym.sym) {
+                        case SDLK_q: 
+                            quit = true;
+                            break;
+                        case SDLK_f:
+                            pipeline.set_render_mode(pipeline.render_mode() == RenderMode::SOLID ? RenderMode::WIREFRAME : RenderMode::SOLID);
+                            break;
+                        case SDLK_h:
+                            pipeline.set_render_mode(pipeline.render_mode() == RenderMode::HIDDEN_LINE ? RenderMode::WIREFRAME : RenderMode::HIDDEN_LINE);
+                            break;
+                        case SDLK_LEFTBRACKET:
+                            pipeline.set_lod_bias(pipeline.lod_bias() - 0.5);
+                            break;
+                        case SDLK_RIGHTBRACKET:
+                            pipeline.set_lod_bias(pipeline.lod_bias() + 0.5);
+                            break;
+                        case SDLK_p:
+                            show_overlay = !show_overlay;
+                            break;
+                        default:
+                            break;
+                    }
                 }
             }
+            if (resync_keys) {
+                resync_keys = !queue_held_keys(input, held);
+            }
+        }
+
+        // the frame is drawn between the snapshot's last two steps, as far along as the time since
+        // the last one. the copy is this frame's and can't change under it.
+        SimSnapshot snapshot;
+        PlayerState view;
+        if (headless) {
+            simulate(current, nullptr, timestep.step_seconds());
+            view = current;
+        } else {
+            snapshot = snapshots.read();
+            const double since = std::chrono::duration<double>(std::chrono::steady_clock::now() - snapshot.stepped).count();
+            view = interpolate(snapshot.previous, snapshot.current, std::clamp(since / timestep.step_seconds(), 0.0, 1.0));
         }
+        const Point<double>& player = view.position;
+        const double camera = view.camera;
 
         // move pointing cube
-        const Point<double> player_pointing (
-            player.x + 0.3*cosl(camera),
+        const Point<Real> player_pointing (
+            player.x + 0.3*std::cos(camera),
             player.y,
-            player.z - 0.3*sinl(camera)
+            player.z - 0.3*std::sin(camera)
         );
-        meshes[1].set_origin(player_pointing);
+        scene.set_origin(pointer, player_pointing);
+
+        // pick up any models that finished loading
+        loader.poll(scene);
 
         // clear screen
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
-
-        for (const Mesh<double>& m : meshes) {
-            for (const Triangle<double>& t : m.tris) {
-
-                Triangle<double> tc = t;
-                tc.a -= player;
-                tc.b -= player;
-                tc.c -= player;
-
-                // rotate around camera
-                double r_xz = 0.0;
-                double a0_xz = 0.0;
-                r_xz = sqrtl(powl(tc.a.x, 2) + powl(tc.a.z, 2));
-                a0_xz = fix_angle(camera - PI/2.0 + atan2l(tc.a.z, tc.a.x));
-                tc.a.x = r_xz * cosl(a0_xz);
-                tc.a.z = r_xz * sinl(a0_xz);
-
-                r_xz = sqrtl(powl(tc.b.x, 2) + powl(tc.b.z, 2));
-                a0_xz = fix_angle(camera - PI/2.0 + atan2l(tc.b.z, tc.b.x));
-                tc.b.x = r_xz * cosl(a0_xz);
-                tc.b.z = r_xz * sinl(a0_xz);
-
-                r_xz = sqrtl(powl(tc.c.x, 2) + powl(tc.c.z, 2));
-                a0_xz = fix_angle(camera - PI/2.0 + atan2l(tc.c.z, tc.c.x));
-                tc.c.x = r_xz * cosl(a0_xz);
-                tc.c.z = r_xz * sinl(a0_xz);
-
-                // orthographic projection
-                project_point(tc.a, player, camera);
-                project_point(tc.b, player, camera);
-                project_point(tc.c, player, camera);
-
-                // scale to size of screen
-                Triangle<int> tci (
-                    scale_point_to_win(tc.a),
-                    scale_point_to_win(tc.b),
-                    scale_point_to_win(tc.c)
-                );
-
-                // clipping/culling
-                using OptionalLine = std::optional<std::tuple<int,int,int,int>>;
-
-                SDL_SetRenderDrawColor(renderer, m.red, m.green, m.blue, 255);
-
-                const OptionalLine ab_clip = cohen_sutherland_clip(tci.a.x, tci.a.y, tci.b.x, tci.b.y, 0, 0, WIN_WIDTH, WIN_HEIGHT);
-                if (ab_clip) {
-                    const auto &[x1, y1, x2, y2] = ab_clip.value();
-                    //SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
-                    SDL_RenderDrawLine(renderer, x1, y1, x2, y2);
-                } 
-                const OptionalLine bc_clip = cohen_sutherland_clip(tci.b.x, tci.b.y, tci.c.x, tci.c.y, 0, 0, WIN_WIDTH, WIN_HEIGHT);
-                if (bc_clip) {
-                    const auto &[x1, y1, x2, y2] = bc_clip.value();
-                    //SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);
-                    SDL_RenderDrawLine(renderer, x1, y1, x2, y2);
-                }
-                const OptionalLine ca_clip = cohen_sutherland_clip(tci.c.x, tci.c.y, tci.a.x, tci.a.y, 0, 0, WIN_WIDTH, WIN_HEIGHT);
-                if (ca_clip) {
-                    const auto &[x1, y1, x2, y2] = ca_clip.value();
-                    //SDL_SetRenderDrawColor(renderer, 0, 0, 255, 255);
-                    SDL_RenderDrawLine(renderer, x1, y1, x2, y2);
+        backend->clear(0, 0, 0);
+
+        // one view-projection matrix per frame, vertices then only need multiply-adds
+        const Mat4<Real> view_proj = make_projection_matrix<Real>(CAM_FOV, CAM_GAP, CAM_FAR) * make_view_matrix(static_cast<Point<Real>>(player), camera);
+
+        pipeline.render(scene, view_proj, viewport);
+
+        // nothing moved since the last frame, its pixels or line batch go out again as they are
+        const bool reused = pipeline.reused_last_frame();
+        reused_frames += reused;
+
+        int draw_calls = 1;
+        if (pipeline.render_mode() == RenderMode::SOLID) {
+            if (!reused) {
+                PROFILE_SCOPE("raster");
+                tiles.render(solid, pipeline.thread_triangles(), Framebuffer::pack(0, 0, 0));
+
+                const RasterStats& r = tiles.raster_stats();
+                raster_total.bin_ms += r.bin_ms;
+                raster_total.raster_ms += r.raster_ms;
+                raster_total.slowest_tile_ms += r.slowest_tile_ms;
+                for (std::size_t t = 0; t < tile_total.size(); t++) {
+                    tile_total[t] += tiles.tile_times()[t];
                 }
+                solid_frames += 1;
+            }
+            PROFILE_SCOPE("submit");
+            backend->draw_framebuffer(solid);
+        } else {
+            // group every thread's segments by colour, then one draw call per colour
+            PROFILE_SCOPE("submit");
+            if (!reused) {
+                batch.clear();
+                batch.add(pipeline.thread_lines());
             }
+            draw_calls = backend->draw_lines(batch);
         }
 
-        SDL_RenderPresent(renderer);
-        SDL_Delay(10);
+        // frame counters in the window title, only touched when they change
+        const FrameStats& stats = pipeline.frame_stats();
+        PROFILE_COUNTER("vertices", stats.vertices_transformed);
+        PROFILE_COUNTER("triangles", stats.triangles_drawn);
+        PROFILE_COUNTER("triangles_culled", stats.triangles_culled + stats.triangles_backfacing);
+        PROFILE_COUNTER("lines_culled", stats.lines_culled);
+        PROFILE_COUNTER("lines_clipped", stats.lines_clipped);
+        PROFILE_COUNTER("draw_calls", draw_calls);
+        // formatted into a fixed buffer and copied into last_title's reserved capacity, so the
+        // title costs no allocations unless it outgrows TITLE_CAPACITY
+        char title[TITLE_CAPACITY];
+        int length = std::snprintf(title, sizeof(title), "%s - meshes %zu drawn/%zu culled, triangles %zu drawn/%zu culled",
+            WIN_TITLE.c_str(), stats.meshes_drawn, stats.meshes_culled, stats.triangles_drawn, stats.triangles_culled);
+        const auto append = [&](const char* format, auto... values) {
+            if (length >= 0 && static_cast<std::size_t>(length) < sizeof(title)) {
+                length += std::snprintf(title + length, sizeof(title) - length, format, values...);
+            }
+        };
+        if (pipeline.render_mode() != RenderMode::WIREFRAME) {
+            append("/%zu back facing", stats.triangles_backfacing);
+        }
+        append("/%zu simplified, %d draw calls", stats.triangles_simplified, draw_calls);
+        if (pipeline.render_mode() == RenderMode::SOLID) {
+            append(", raster %ld ms", std::lround(tiles.raster_stats().bin_ms + tiles.raster_stats().raster_ms));
+        }
+        if (last_title != title) {
+            last_title.assign(title);
+            backend->set_title(last_title);
+        }
+
+#ifdef ENGINE_PROFILE
+        if (show_overlay) {
+            overlay.clear();
+            draw_profile_overlay(profiler(), overlay, viewport);
+            backend->draw_lines(overlay);
+        }
+#endif
+        {
+            PROFILE_SCOPE("present");
+            backend->present();
+        }
+        if (snapshot.newest_input > last_input_shown) {
+            last_input_shown = snapshot.newest_input;
+            if (latencies.size() < MAX_LATENCY_SAMPLES) {
+                latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - last_input_shown).count());
+            }
+        }
+        PROFILE_FRAME();
         tick += 1;
+        if (headless) {
+            quit = tick >= options->headless_frames;
+        }
+        pacer.wait();
+        if (tick > warmup_frames) {
+            const std::size_t n = heap_allocations() - allocations_before;
+            steady_allocations += n;
+            allocating_frames += n > 0;
+        }
+    }
+    stop_simulation.store(true, std::memory_order_relaxed);
+    if (simulation.joinable()) {
+        simulation.join();
     }
 
-    // cleanup and exit
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
-    SDL_Quit();
+    if (headless) {
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        std::cout << tick << " frames in " << seconds << " s, " << tick / seconds << " frames/s" << std::endl;
+
+        // mean raster cost per frame, then per tile laid out like the screen
+        if (solid_frames > 0) {
+            std::cout << "raster " << (raster_total.bin_ms + raster_total.raster_ms) / solid_frames << " ms/frame"
+                << " (binning " << raster_total.bin_ms / solid_frames << " ms, tiles " << raster_total.raster_ms / solid_frames << " ms"
+                << ", slowest tile " << raster_total.slowest_tile_ms / solid_frames << " ms)" << std::endl;
+            std::cout << "tile ms/frame:" << std::endl;
+            for (int ty = 0; ty < tiles.tile_rows(); ty++) {
+                for (int tx = 0; tx < tiles.tile_columns(); tx++) {
+                    std::printf(" %6.3f", tile_total[static_cast<std::size_t>(ty) * tiles.tile_columns() + tx] / solid_frames);
+                }
+                std::printf("\n");
+            }
+        }
+        if (!options->dump_path.empty() && !software->frame().write_ppm(options->dump_path)) {
+            std::cerr << "Couldn't write " << options->dump_path << std::endl;
+            return 1;
+        }
+    }
+
+    pacer.write_report(std::cout);
+    std::cout << reused_frames << " of " << tick << " frames reused the last frame's geometry" << std::endl;
+    write_latency_report(std::cout, latencies);
+
+    if (options->check_allocations) {
+        std::cout << steady_allocations << " heap allocations in " << allocating_frames << " of the "
+            << tick - warmup_frames << " frames after the warm up" << std::endl;
+        if (steady_allocations > 0) {
+            std::cerr << "Steady state frames allocated" << std::endl;
+            return 1;
+        }
+    }
+
+#ifdef ENGINE_PROFILE
+    if (headless) {
+        profiler().write_summary(std::cout);
+    }
+    if (!options->trace_path.empty() && !profiler().write_chrome_trace(options->trace_path)) {
+        std::cerr << "Couldn't write " << options->trace_path << std::endl;
+        return 1;
+    }
+    if (!options->profile_csv_path.empty() && !profiler().write_csv(options->profile_csv_path)) {
+        std::cerr << "Couldn't write " << options->profile_csv_path << std::endl;
+        return 1;
+    }
+#endif
     return 0;
 }
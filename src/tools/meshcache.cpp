@@ -0,0 +1,52 @@
+// builds the binary mesh cache for every model in a models.csv and reports cold (text parse,
+// simplification and cache write) and warm load times. both time the whole load_geometry the
+// engine runs on a background thread, up to the Geometry and its levels of detail.
+#include <iostream>
+#include <set>
+#include <chrono>
+#include <filesystem>
+#include "../include/SceneLoader.hpp"
+#include "../include/MeshCache.hpp"
+
+template <typename F>
+double milliseconds(F fn) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+int main(int argc, char* argv[]) {
+    const std::filesystem::path models_csv = argc > 1 ? argv[1] : "models.csv";
+    const std::optional<std::vector<ModelPlacement>> placements = load_placements(models_csv);
+    if (!placements) {
+        return 1;
+    }
+
+    std::set<std::string> files;
+    for (const ModelPlacement& p : placements.value()) {
+        files.insert(p.file);
+    }
+
+    std::cout << "model\tvertices\tfaces\tlevels\tcold ms\twarm ms\n";
+    for (const std::string& file : files) {
+        std::error_code ec;
+        std::filesystem::remove(mesh_cache_path(file), ec);
+
+        GeometryPtr<double> cold;
+        const double cold_ms = milliseconds([&] { cold = load_geometry<double>(file); });
+        if (!cold) {
+            continue;
+        }
+
+        if (!read_mesh_cache(file)) {
+            std::cerr << "No usable cache for " << file << std::endl;
+            continue;
+        }
+        GeometryPtr<double> warm;
+        const double warm_ms = milliseconds([&] { warm = load_geometry<double>(file); });
+
+        std::cout << file << '\t' << cold->verts.size() << '\t' << cold->faces.size() << '\t' << cold->lods.size() << '\t' << cold_ms << '\t' << warm_ms << '\n';
+    }
+    return 0;
+}